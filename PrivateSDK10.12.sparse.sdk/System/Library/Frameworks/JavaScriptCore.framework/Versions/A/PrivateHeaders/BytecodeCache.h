@@ -0,0 +1,650 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef BytecodeCache_h
+#define BytecodeCache_h
+
+#include "SourceCodeKey.h"
+#include <algorithm>
+#include <errno.h>
+#include <wtf/HashMap.h>
+#include <wtf/Optional.h>
+#include <wtf/RefPtr.h>
+#include <wtf/SHA1.h>
+#include <wtf/StdLibExtras.h>
+#include <wtf/ThreadSafeRefCounted.h>
+#include <wtf/Vector.h>
+#include <wtf/text/CString.h>
+#include <wtf/text/StringHash.h>
+#include <wtf/text/WTFString.h>
+
+#if OS(UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace JSC {
+
+// The container format of a persistent cache of unlinked code, written once and mapped read-only
+// on later launches. Only the container exists: there is no encoder or decoder for
+// UnlinkedCodeBlock, so nothing produces or consumes these files yet.
+//
+// FIXME: Encode and decode UnlinkedProgramCodeBlock and UnlinkedFunctionExecutable next to the
+// bytecode generator, and consult a BytecodeCacheFile in CodeCache::getProgramCodeBlock().
+//
+// File layout. Integers are in host byte order; a file written by a different build is rejected
+// through the build identifier in its header.
+//
+//     BytecodeCacheFileHeader
+//     BytecodeCacheFileEntry[entryCount], sorted by key
+//     entry payloads, each 8-byte aligned
+//
+// An entry payload holds the encoded code block and one encoded body per UnlinkedFunctionExecutable:
+//
+//     uint32_t codeBlockLength, functionCount
+//     { uint32_t offset, length }[functionCount], relative to the start of the payload
+//     code block bytes, function body bytes...
+//
+// A function body is only decoded when BytecodeCachePayload::function() is asked for it, so a
+// reader can leave each function encoded until it is first called.
+
+typedef SHA1::Digest BytecodeCacheBuildIdentifier;
+
+// SourceCodeKey compares source text, which is not available when looking up a mapped file, so the
+// on-disk key replaces the text and name with a SHA-1 of both.
+struct BytecodeCacheKey {
+    BytecodeCacheKey() = default;
+
+    BytecodeCacheKey(WTF::HashTableDeletedValueType)
+        : flags(std::numeric_limits<uint32_t>::max())
+    {
+    }
+
+    explicit BytecodeCacheKey(const SourceCodeKey& key)
+        : flags(key.flags().bits())
+        , length(key.length())
+    {
+        SHA1 sha1;
+        addToHash(sha1, key.name());
+        addToHash(sha1, key.string());
+        sha1.computeHash(contentHash);
+    }
+
+    bool operator==(const BytecodeCacheKey& other) const
+    {
+        return contentHash == other.contentHash && flags == other.flags && length == other.length;
+    }
+
+    bool operator<(const BytecodeCacheKey& other) const
+    {
+        if (contentHash != other.contentHash)
+            return contentHash < other.contentHash;
+        if (flags != other.flags)
+            return flags < other.flags;
+        return length < other.length;
+    }
+
+    // Real flags only use the low byte, so all ones marks the deleted value.
+    bool isHashTableDeletedValue() const { return flags == std::numeric_limits<uint32_t>::max(); }
+
+    struct Hash {
+        static unsigned hash(const BytecodeCacheKey& key)
+        {
+            // The content hash is already uniformly distributed.
+            unsigned result;
+            memcpy(&result, key.contentHash.data(), sizeof(result));
+            return result ^ key.flags;
+        }
+        static bool equal(const BytecodeCacheKey& a, const BytecodeCacheKey& b) { return a == b; }
+        static const bool safeToCompareToEmptyOrDeleted = true;
+    };
+
+    struct HashTraits : SimpleClassHashTraits<BytecodeCacheKey> {
+        static const bool emptyValueIsZero = false;
+    };
+
+    SHA1::Digest contentHash { };
+    uint32_t flags { 0 };
+    uint32_t length { 0 };
+
+private:
+    static void addToHash(SHA1& sha1, StringView string)
+    {
+        uint8_t is8Bit = string.is8Bit();
+        uint32_t length = string.length();
+        sha1.addBytes(&is8Bit, sizeof(is8Bit));
+        sha1.addBytes(reinterpret_cast<const uint8_t*>(&length), sizeof(length));
+        if (string.is8Bit())
+            sha1.addBytes(string.characters8(), length);
+        else
+            sha1.addBytes(reinterpret_cast<const uint8_t*>(string.characters16()), length * sizeof(UChar));
+    }
+};
+
+struct BytecodeCacheFileHeader {
+    static const uint32_t expectedMagic = 0x4342534a; // "JSBC"
+    static const uint32_t currentFormatVersion = 1;
+
+    uint32_t magic;
+    uint32_t formatVersion;
+    BytecodeCacheBuildIdentifier buildIdentifier;
+    uint32_t entryCount;
+    uint64_t entriesOffset;
+    uint64_t fileSize;
+};
+
+struct BytecodeCacheFileEntry {
+    SHA1::Digest contentHash;
+    uint32_t flags;
+    uint32_t length;
+    uint32_t padding;
+    uint64_t payloadOffset;
+    uint64_t payloadLength;
+
+    BytecodeCacheKey key() const
+    {
+        BytecodeCacheKey result;
+        result.contentHash = contentHash;
+        result.flags = flags;
+        result.length = length;
+        return result;
+    }
+};
+
+static_assert(sizeof(BytecodeCacheFileEntry) == 48, "BytecodeCacheFileEntry is part of the file format");
+
+// Variable-length encoding for the contents of a payload. Strings are written once per encoder and
+// referred back to by index afterwards, since identifiers repeat heavily across a program.
+class BytecodeEncoder {
+    WTF_MAKE_NONCOPYABLE(BytecodeEncoder);
+public:
+    BytecodeEncoder() = default;
+
+    void encodeBool(bool value)
+    {
+        m_buffer.append(value);
+    }
+
+    void encodeUInt32(uint32_t value)
+    {
+        encodeUInt64(value);
+    }
+
+    void encodeInt32(int32_t value)
+    {
+        encodeUInt32((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+    }
+
+    void encodeUInt64(uint64_t value)
+    {
+        while (value >= 0x80) {
+            m_buffer.append(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        m_buffer.append(static_cast<uint8_t>(value));
+    }
+
+    void encodeDouble(double value)
+    {
+        uint64_t bits = bitwise_cast<uint64_t>(value);
+        m_buffer.append(reinterpret_cast<const uint8_t*>(&bits), sizeof(bits));
+    }
+
+    // Tag 0 is the null string, tag 1 a new string, and tag n + 2 the nth string already encoded.
+    void encodeString(const String& string)
+    {
+        if (string.isNull()) {
+            encodeUInt32(0);
+            return;
+        }
+        auto addResult = m_stringIndices.add(string, m_stringIndices.size());
+        if (!addResult.isNewEntry) {
+            encodeUInt32(addResult.iterator->value + 2);
+            return;
+        }
+        encodeUInt32(1);
+        encodeBool(string.is8Bit());
+        encodeUInt32(string.length());
+        if (string.is8Bit())
+            m_buffer.append(string.characters8(), string.length());
+        else
+            m_buffer.append(reinterpret_cast<const uint8_t*>(string.characters16()), string.length() * sizeof(UChar));
+    }
+
+    const Vector<uint8_t>& buffer() const { return m_buffer; }
+    Vector<uint8_t> takeBuffer() { return WTFMove(m_buffer); }
+
+private:
+    Vector<uint8_t> m_buffer;
+    HashMap<String, uint32_t> m_stringIndices;
+};
+
+// Reads what BytecodeEncoder wrote. Every read is bounds checked and returns false on malformed
+// input, so a truncated or corrupt file turns into a cache miss.
+class BytecodeDecoder {
+public:
+    BytecodeDecoder(const uint8_t* data, size_t size)
+        : m_cursor(data)
+        , m_end(data + size)
+    {
+    }
+
+    bool isAtEnd() const { return m_cursor == m_end; }
+
+    bool decodeBool(bool& result)
+    {
+        if (m_cursor == m_end || *m_cursor > 1)
+            return false;
+        result = *m_cursor++;
+        return true;
+    }
+
+    bool decodeUInt32(uint32_t& result)
+    {
+        uint64_t value;
+        if (!decodeUInt64(value) || value > std::numeric_limits<uint32_t>::max())
+            return false;
+        result = static_cast<uint32_t>(value);
+        return true;
+    }
+
+    bool decodeInt32(int32_t& result)
+    {
+        uint32_t value;
+        if (!decodeUInt32(value))
+            return false;
+        result = static_cast<int32_t>((value >> 1) ^ (0 - (value & 1)));
+        return true;
+    }
+
+    bool decodeUInt64(uint64_t& result)
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (m_cursor == m_end)
+                return false;
+            uint8_t byte = *m_cursor++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                result = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool decodeDouble(double& result)
+    {
+        uint64_t bits;
+        if (static_cast<size_t>(m_end - m_cursor) < sizeof(bits))
+            return false;
+        memcpy(&bits, m_cursor, sizeof(bits));
+        m_cursor += sizeof(bits);
+        result = bitwise_cast<double>(bits);
+        return true;
+    }
+
+    bool decodeString(String& result)
+    {
+        uint32_t tag;
+        if (!decodeUInt32(tag))
+            return false;
+        if (!tag) {
+            result = String();
+            return true;
+        }
+        if (tag >= 2) {
+            if (tag - 2 >= m_strings.size())
+                return false;
+            result = m_strings[tag - 2];
+            return true;
+        }
+        bool is8Bit;
+        uint32_t length;
+        if (!decodeBool(is8Bit) || !decodeUInt32(length))
+            return false;
+        size_t byteLength = is8Bit ? length : static_cast<size_t>(length) * sizeof(UChar);
+        if (static_cast<size_t>(m_end - m_cursor) < byteLength)
+            return false;
+        if (is8Bit)
+            result = String(m_cursor, length);
+        else {
+            UChar* characters;
+            result = String::createUninitialized(length, characters);
+            memcpy(characters, m_cursor, byteLength);
+        }
+        m_cursor += byteLength;
+        m_strings.append(result);
+        return true;
+    }
+
+private:
+    const uint8_t* m_cursor;
+    const uint8_t* m_end;
+    Vector<String> m_strings;
+};
+
+// The framing shared by every holder of encoded code: a function table, the code block, and the
+// function bodies, as laid out in the comment at the top of this file.
+class BytecodeCachePayload {
+public:
+    static Vector<uint8_t> encode(const Vector<uint8_t>& codeBlock, const Vector<Vector<uint8_t>>& functions)
+    {
+        Vector<uint8_t> payload;
+        uint32_t counts[2] = { static_cast<uint32_t>(codeBlock.size()), static_cast<uint32_t>(functions.size()) };
+        payload.append(reinterpret_cast<const uint8_t*>(counts), sizeof(counts));
+        uint32_t offset = functionTableOffset + functions.size() * sizeof(uint32_t[2]) + codeBlock.size();
+        for (const Vector<uint8_t>& function : functions) {
+            uint32_t range[2] = { offset, static_cast<uint32_t>(function.size()) };
+            payload.append(reinterpret_cast<const uint8_t*>(range), sizeof(range));
+            offset += function.size();
+        }
+        payload.appendVector(codeBlock);
+        for (const Vector<uint8_t>& function : functions)
+            payload.appendVector(function);
+        return payload;
+    }
+
+    // Checks the function table against the payload bounds; the bytes must outlive the result.
+    static Optional<BytecodeCachePayload> parse(const uint8_t* data, uint64_t length)
+    {
+        uint32_t counts[2];
+        if (length < sizeof(counts))
+            return Nullopt;
+        memcpy(counts, data, sizeof(counts));
+        uint32_t codeBlockLength = counts[0];
+        uint32_t functionCount = counts[1];
+        if ((length - functionTableOffset) / sizeof(uint32_t[2]) < functionCount)
+            return Nullopt;
+        uint64_t codeBlockOffset = functionTableOffset + static_cast<uint64_t>(functionCount) * sizeof(uint32_t[2]);
+        if (codeBlockLength > length - codeBlockOffset)
+            return Nullopt;
+        for (uint32_t i = 0; i < functionCount; ++i) {
+            uint32_t range[2];
+            memcpy(range, data + functionTableOffset + i * sizeof(range), sizeof(range));
+            if (range[0] > length || range[1] > length - range[0])
+                return Nullopt;
+        }
+
+        BytecodeCachePayload payload;
+        payload.m_data = data;
+        payload.m_codeBlockOffset = codeBlockOffset;
+        payload.m_codeBlockLength = codeBlockLength;
+        payload.m_functionCount = functionCount;
+        return payload;
+    }
+
+    BytecodeDecoder codeBlock() const
+    {
+        return BytecodeDecoder(m_data + m_codeBlockOffset, m_codeBlockLength);
+    }
+
+    unsigned functionCount() const { return m_functionCount; }
+
+    BytecodeDecoder function(unsigned index) const
+    {
+        RELEASE_ASSERT(index < m_functionCount);
+        uint32_t range[2];
+        memcpy(range, m_data + functionTableOffset + index * sizeof(range), sizeof(range));
+        return BytecodeDecoder(m_data + range[0], range[1]);
+    }
+
+private:
+    static const size_t functionTableOffset = 2 * sizeof(uint32_t);
+
+    const uint8_t* m_data { nullptr };
+    uint32_t m_codeBlockOffset { 0 };
+    uint32_t m_codeBlockLength { 0 };
+    uint32_t m_functionCount { 0 };
+};
+
+class BytecodeCacheEntry;
+
+// A read-only mapping of a cache file. open() validates the header and the entry table; find()
+// validates the payload it returns. The mapping is immutable, so one file can serve every VM in
+// the process.
+class BytecodeCacheFile : public ThreadSafeRefCounted<BytecodeCacheFile> {
+public:
+    static RefPtr<BytecodeCacheFile> open(const String& path, const BytecodeCacheBuildIdentifier& buildIdentifier)
+    {
+#if OS(UNIX)
+        int fd = ::open(path.utf8().data(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            return nullptr;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) || static_cast<size_t>(fileStat.st_size) < sizeof(BytecodeCacheFileHeader)) {
+            close(fd);
+            return nullptr;
+        }
+        size_t size = fileStat.st_size;
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return nullptr;
+
+        RefPtr<BytecodeCacheFile> file = adoptRef(new BytecodeCacheFile(static_cast<const uint8_t*>(data), size));
+        if (!file->validate(buildIdentifier))
+            return nullptr;
+        return file;
+#else
+        UNUSED_PARAM(path);
+        UNUSED_PARAM(buildIdentifier);
+        return nullptr;
+#endif
+    }
+
+    ~BytecodeCacheFile()
+    {
+#if OS(UNIX)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    }
+
+    unsigned entryCount() const { return m_entryCount; }
+
+    Optional<BytecodeCacheEntry> find(const BytecodeCacheKey&);
+
+private:
+    BytecodeCacheFile(const uint8_t* data, size_t size)
+        : m_data(data)
+        , m_size(size)
+    {
+    }
+
+    bool validate(const BytecodeCacheBuildIdentifier& buildIdentifier)
+    {
+        BytecodeCacheFileHeader header;
+        memcpy(&header, m_data, sizeof(header));
+        if (header.magic != BytecodeCacheFileHeader::expectedMagic
+            || header.formatVersion != BytecodeCacheFileHeader::currentFormatVersion
+            || header.buildIdentifier != buildIdentifier
+            || header.fileSize != m_size
+            || header.entriesOffset % alignof(BytecodeCacheFileEntry)
+            || header.entriesOffset > m_size
+            || (m_size - header.entriesOffset) / sizeof(BytecodeCacheFileEntry) < header.entryCount)
+            return false;
+
+        m_entries = reinterpret_cast<const BytecodeCacheFileEntry*>(m_data + header.entriesOffset);
+        m_entryCount = header.entryCount;
+        for (unsigned i = 0; i < m_entryCount; ++i) {
+            const BytecodeCacheFileEntry& entry = m_entries[i];
+            if (entry.payloadOffset > m_size || entry.payloadLength > m_size - entry.payloadOffset)
+                return false;
+            if (i && !(m_entries[i - 1].key() < entry.key()))
+                return false;
+        }
+        return true;
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    const BytecodeCacheFileEntry* m_entries { nullptr };
+    unsigned m_entryCount { 0 };
+};
+
+// One cached top-level program. The entry keeps its file mapped for as long as it lives.
+class BytecodeCacheEntry {
+public:
+    BytecodeDecoder codeBlock() const { return m_payload.codeBlock(); }
+    unsigned functionCount() const { return m_payload.functionCount(); }
+    BytecodeDecoder function(unsigned index) const { return m_payload.function(index); }
+
+private:
+    friend class BytecodeCacheFile;
+
+    BytecodeCacheEntry(RefPtr<BytecodeCacheFile>&& file, const BytecodeCachePayload& payload)
+        : m_file(WTFMove(file))
+        , m_payload(payload)
+    {
+    }
+
+    RefPtr<BytecodeCacheFile> m_file;
+    BytecodeCachePayload m_payload;
+};
+
+inline Optional<BytecodeCacheEntry> BytecodeCacheFile::find(const BytecodeCacheKey& key)
+{
+    const BytecodeCacheFileEntry* end = m_entries + m_entryCount;
+    const BytecodeCacheFileEntry* entry = std::lower_bound(m_entries, end, key, [] (const BytecodeCacheFileEntry& entry, const BytecodeCacheKey& key) {
+        return entry.key() < key;
+    });
+    if (entry == end || !(entry->key() == key))
+        return Nullopt;
+    Optional<BytecodeCachePayload> payload = BytecodeCachePayload::parse(m_data + entry->payloadOffset, entry->payloadLength);
+    if (!payload)
+        return Nullopt;
+    return BytecodeCacheEntry(this, payload.value());
+}
+
+// Collects encoded programs and writes them out as a cache file. The file is written next to its
+// final path and renamed into place, so readers never map a partially written file.
+class BytecodeCacheWriter {
+    WTF_MAKE_NONCOPYABLE(BytecodeCacheWriter);
+public:
+    explicit BytecodeCacheWriter(const BytecodeCacheBuildIdentifier& buildIdentifier)
+        : m_buildIdentifier(buildIdentifier)
+    {
+    }
+
+    void add(const BytecodeCacheKey& key, const Vector<uint8_t>& codeBlock, const Vector<Vector<uint8_t>>& functions)
+    {
+        m_entries.append({ key, BytecodeCachePayload::encode(codeBlock, functions) });
+    }
+
+    bool write(const String& path)
+    {
+#if OS(UNIX)
+        std::stable_sort(m_entries.begin(), m_entries.end(), [] (const Entry& a, const Entry& b) {
+            return a.key < b.key;
+        });
+        // The first entry added for a key wins.
+        Vector<const Entry*> entries;
+        for (const Entry& entry : m_entries) {
+            if (entries.isEmpty() || !(entries.last()->key == entry.key))
+                entries.append(&entry);
+        }
+
+        Vector<uint8_t> contents;
+        BytecodeCacheFileHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = BytecodeCacheFileHeader::expectedMagic;
+        header.formatVersion = BytecodeCacheFileHeader::currentFormatVersion;
+        header.buildIdentifier = m_buildIdentifier;
+        header.entryCount = entries.size();
+        header.entriesOffset = WTF::roundUpToMultipleOf<payloadAlignment>(sizeof(header));
+
+        uint64_t payloadOffset = header.entriesOffset + entries.size() * sizeof(BytecodeCacheFileEntry);
+        Vector<BytecodeCacheFileEntry> table;
+        for (const Entry* entry : entries) {
+            payloadOffset = WTF::roundUpToMultipleOf<payloadAlignment>(payloadOffset);
+            BytecodeCacheFileEntry fileEntry;
+            memset(&fileEntry, 0, sizeof(fileEntry));
+            fileEntry.contentHash = entry->key.contentHash;
+            fileEntry.flags = entry->key.flags;
+            fileEntry.length = entry->key.length;
+            fileEntry.payloadOffset = payloadOffset;
+            fileEntry.payloadLength = entry->payload.size();
+            table.append(fileEntry);
+            payloadOffset += entry->payload.size();
+        }
+        header.fileSize = payloadOffset;
+
+        contents.reserveInitialCapacity(header.fileSize);
+        contents.append(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+        contents.grow(header.entriesOffset);
+        contents.append(reinterpret_cast<const uint8_t*>(table.data()), table.size() * sizeof(BytecodeCacheFileEntry));
+        for (unsigned i = 0; i < entries.size(); ++i) {
+            contents.grow(table[i].payloadOffset);
+            contents.appendVector(entries[i]->payload);
+        }
+        ASSERT(contents.size() == header.fileSize);
+
+        CString finalPath = path.utf8();
+        CString temporaryPath = makeString(path, ".tmp").utf8();
+        int fd = ::open(temporaryPath.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+            return false;
+        const uint8_t* cursor = contents.data();
+        size_t remaining = contents.size();
+        while (remaining) {
+            ssize_t written = ::write(fd, cursor, remaining);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                close(fd);
+                unlink(temporaryPath.data());
+                return false;
+            }
+            cursor += written;
+            remaining -= written;
+        }
+        if (close(fd) || rename(temporaryPath.data(), finalPath.data())) {
+            unlink(temporaryPath.data());
+            return false;
+        }
+        return true;
+#else
+        UNUSED_PARAM(path);
+        return false;
+#endif
+    }
+
+private:
+    static const size_t payloadAlignment = 8;
+
+    struct Entry {
+        BytecodeCacheKey key;
+        Vector<uint8_t> payload;
+    };
+
+    BytecodeCacheBuildIdentifier m_buildIdentifier;
+    Vector<Entry> m_entries;
+};
+
+} // namespace JSC
+
+#endif // BytecodeCache_h
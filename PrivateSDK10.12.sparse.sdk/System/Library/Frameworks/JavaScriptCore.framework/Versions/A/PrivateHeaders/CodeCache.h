@@ -181,6 +181,11 @@ private:
 };
 
 // Caches top-level code such as <script>, eval(), new Function, and JSEvaluateScript().
+//
+// FIXME: Parse and generate bytecode off the thread that holds the JSLock, and adopt the result
+// here when evaluation starts. The parser allocates from its VM's ParserArena and identifier table,
+// and an UnlinkedCodeBlock is a cell in one VM's heap, so the background thread needs to produce an
+// encoded block that the evaluating VM decodes. No UnlinkedCodeBlock decoder exists yet.
 class CodeCache {
     WTF_MAKE_FAST_ALLOCATED;
 public:
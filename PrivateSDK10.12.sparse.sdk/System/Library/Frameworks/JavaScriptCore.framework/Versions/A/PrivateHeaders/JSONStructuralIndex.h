@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef JSONStructuralIndex_h
+#define JSONStructuralIndex_h
+
+#include <string.h>
+#include <wtf/Vector.h>
+#include <wtf/text/LChar.h>
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace JSC {
+
+// The first stage of JSONStructuralParser. It classifies the source 64 characters at a time into
+// bit masks, works out from those which quotes are escaped and which characters are inside
+// strings, and records the position of every character the second stage has to look at: each
+// of {}[]:, outside strings, both quotes of every string, and the first character of every
+// other token. Along the way it rejects unterminated strings and strings containing unescaped
+// control characters. Everything else is left for the second stage to validate.
+class JSONStructuralIndex {
+    WTF_MAKE_NONCOPYABLE(JSONStructuralIndex);
+public:
+    JSONStructuralIndex() { }
+
+    template<typename CharacterType>
+    bool build(const CharacterType* characters, unsigned length)
+    {
+        m_positions.clear();
+        m_positions.reserveInitialCapacity(length / 8 + 1);
+
+        State state;
+        unsigned offset = 0;
+        for (; length - offset >= blockSize; offset += blockSize) {
+            if (!indexBlock(classify(characters + offset), offset, state))
+                return false;
+        }
+        if (offset < length) {
+            // Pad the last block with spaces, which add nothing to the index.
+            CharacterType block[blockSize];
+            unsigned remaining = length - offset;
+            memcpy(block, characters + offset, remaining * sizeof(CharacterType));
+            for (unsigned i = remaining; i < blockSize; ++i)
+                block[i] = ' ';
+            if (!indexBlock(classify(block), offset, state))
+                return false;
+        }
+        return !state.inString;
+    }
+
+    unsigned size() const { return m_positions.size(); }
+    unsigned operator[](unsigned i) const { return m_positions[i]; }
+
+private:
+    static const unsigned blockSize = 64;
+
+    struct BlockMasks {
+        uint64_t quote { 0 };
+        uint64_t backslash { 0 };
+        uint64_t op { 0 };
+        uint64_t whiteSpace { 0 };
+        uint64_t control { 0 };
+    };
+
+    struct State {
+        uint64_t escaped { 0 };
+        uint64_t inString { 0 };
+        uint64_t scalar { 0 };
+    };
+
+    static bool isOp(unsigned character)
+    {
+        return character == '{' || character == '}' || character == '[' || character == ']' || character == ':' || character == ',';
+    }
+
+    static bool isWhiteSpace(unsigned character)
+    {
+        return character == ' ' || character == '\t' || character == '\n' || character == '\r';
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    static void classify(__m128i characters, unsigned shift, BlockMasks& masks)
+    {
+        // Setting bit 5 maps '[' and ']' onto '{' and '}', and nothing else onto either.
+        __m128i folded = _mm_or_si128(characters, _mm_set1_epi8(0x20));
+        __m128i op = _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+        op = _mm_or_si128(op, _mm_or_si128(_mm_cmpeq_epi8(characters, _mm_set1_epi8(':')), _mm_cmpeq_epi8(characters, _mm_set1_epi8(','))));
+        __m128i whiteSpace = _mm_or_si128(_mm_cmpeq_epi8(characters, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(characters, _mm_set1_epi8('\t')));
+        whiteSpace = _mm_or_si128(whiteSpace, _mm_or_si128(_mm_cmpeq_epi8(characters, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(characters, _mm_set1_epi8('\r'))));
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(characters, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+
+        masks.quote |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(characters, _mm_set1_epi8('"')))) << shift;
+        masks.backslash |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(characters, _mm_set1_epi8('\\')))) << shift;
+        masks.op |= static_cast<uint64_t>(_mm_movemask_epi8(op)) << shift;
+        masks.whiteSpace |= static_cast<uint64_t>(_mm_movemask_epi8(whiteSpace)) << shift;
+        masks.control |= static_cast<uint64_t>(_mm_movemask_epi8(control)) << shift;
+    }
+
+    static BlockMasks classify(const LChar* block)
+    {
+        BlockMasks masks;
+        for (unsigned i = 0; i < blockSize; i += 16)
+            classify(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i)), i, masks);
+        return masks;
+    }
+
+    static __m128i narrow(const UChar* characters)
+    {
+        // Clamp every character above 0xFF to 0xFF, which is none of the characters we look for and
+        // not a control character. Lanes from 0x8000 up are negative, which packus would clamp to 0.
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters + 8));
+        __m128i lowSign = _mm_srai_epi16(low, 15);
+        __m128i highSign = _mm_srai_epi16(high, 15);
+        low = _mm_or_si128(_mm_andnot_si128(lowSign, low), _mm_and_si128(lowSign, _mm_set1_epi16(0xFF)));
+        high = _mm_or_si128(_mm_andnot_si128(highSign, high), _mm_and_si128(highSign, _mm_set1_epi16(0xFF)));
+        return _mm_packus_epi16(low, high);
+    }
+
+    static BlockMasks classify(const UChar* block)
+    {
+        BlockMasks masks;
+        for (unsigned i = 0; i < blockSize; i += 16)
+            classify(narrow(block + i), i, masks);
+        return masks;
+    }
+#else
+    template<typename CharacterType>
+    static BlockMasks classify(const CharacterType* block)
+    {
+        BlockMasks masks;
+        for (unsigned i = 0; i < blockSize; ++i) {
+            CharacterType character = block[i];
+            uint64_t bit = static_cast<uint64_t>(1) << i;
+            if (character == '"')
+                masks.quote |= bit;
+            else if (character == '\\')
+                masks.backslash |= bit;
+            else if (isOp(character))
+                masks.op |= bit;
+            if (isWhiteSpace(character))
+                masks.whiteSpace |= bit;
+            if (character < 0x20)
+                masks.control |= bit;
+        }
+        return masks;
+    }
+#endif
+
+    // Returns the characters that are escaped by an odd-length run of backslashes. state.escaped
+    // carries whether the first character of the next block is escaped.
+    static uint64_t escapedCharacters(uint64_t backslash, State& state)
+    {
+        const uint64_t evenBits = 0x5555555555555555ULL;
+        backslash &= ~state.escaped;
+        uint64_t followsEscape = backslash << 1 | state.escaped;
+        uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+        uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+        state.escaped = sequencesStartingOnEvenBits < backslash;
+        uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+        return (evenBits ^ invertMask) & followsEscape;
+    }
+
+    // Bit i of the result is the parity of bits 0 through i.
+    static uint64_t prefixXor(uint64_t bits)
+    {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+
+    bool indexBlock(const BlockMasks& masks, unsigned offset, State& state)
+    {
+        uint64_t quote = masks.quote & ~escapedCharacters(masks.backslash, state);
+
+        // Set from each opening quote up to, but not including, its closing quote.
+        uint64_t inString = prefixXor(quote) ^ state.inString;
+        state.inString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+        uint64_t stringBody = inString & ~quote;
+        if (masks.control & stringBody)
+            return false;
+
+        uint64_t scalar = ~(masks.op | masks.whiteSpace | quote);
+        uint64_t scalarStart = scalar & ~(scalar << 1 | state.scalar);
+        state.scalar = scalar >> 63;
+
+        uint64_t structurals = ((masks.op | scalarStart) & ~stringBody) | quote;
+        size_t size = m_positions.size();
+        m_positions.grow(size + __builtin_popcountll(structurals));
+        unsigned* positions = m_positions.data() + size;
+        while (structurals) {
+            *positions++ = offset + __builtin_ctzll(structurals);
+            structurals &= structurals - 1;
+        }
+        return true;
+    }
+
+    Vector<unsigned> m_positions;
+};
+
+} // namespace JSC
+
+#endif // JSONStructuralIndex_h
@@ -0,0 +1,514 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef JSONStructuralParser_h
+#define JSONStructuralParser_h
+
+#include "ArgList.h"
+#include "ButterflyInlines.h"
+#include "DeferGC.h"
+#include "Identifier.h"
+#include "JSArray.h"
+#include "JSGlobalObject.h"
+#include "JSONObject.h"
+#include "JSONStructuralIndex.h"
+#include "JSString.h"
+#include "ObjectConstructor.h"
+#include "StructureInlines.h"
+#include <array>
+#include <wtf/ASCIICType.h>
+#include <wtf/HashFunctions.h>
+#include <wtf/dtoa.h>
+#include <wtf/text/StringBuilder.h>
+
+namespace JSC {
+
+// A two stage JSON.parse for large inputs. JSONStructuralIndex first finds every token in one
+// vectorized pass; this then walks the index and builds the result. Each object's keys and values
+// are collected before the object is made, so that objects with the same keys in the same order
+// can share one Structure, looked up once, and have their properties stored straight into their
+// slots rather than transitioning one put at a time.
+//
+// The result is the same as LiteralParser's in StrictJSON mode. tryParse() returns the empty value
+// for anything it does not handle, including every malformed input and very deep nesting, and the
+// caller must then parse with LiteralParser. JSONParseWithStructuralIndex() below does both steps.
+//
+// The parser must live on the stack. Nothing visits its shape cache, so the Structures in it stay
+// alive only through the conservative scan of the stack and the objects built from them.
+template<typename CharacterType>
+class JSONStructuralParser {
+    WTF_MAKE_NONCOPYABLE(JSONStructuralParser);
+public:
+    static JSValue tryParse(ExecState* exec, const CharacterType* characters, unsigned length)
+    {
+        JSONStructuralParser parser(exec, characters, length);
+        if (!parser.m_index.build(characters, length))
+            return JSValue();
+        JSValue result = parser.parseValue(0);
+        if (!result || parser.m_next != parser.m_index.size())
+            return JSValue();
+        return result;
+    }
+
+private:
+    static const unsigned maximumDepth = 512;
+    static const unsigned shapeCacheSize = 64;
+
+    JSONStructuralParser(ExecState* exec, const CharacterType* characters, unsigned length)
+        : m_exec(exec)
+        , m_vm(exec->vm())
+        , m_characters(characters)
+        , m_length(length)
+    {
+    }
+
+    // The Structure for one key list, and the Structure after each key, which is where the generic
+    // put path would account for the value stored under it. isNewTransition marks the Structures
+    // this parser created, until the first object that uses them has told them about its values.
+    struct ObjectShape {
+        void clear()
+        {
+            keys.shrink(0);
+            structures.shrink(0);
+            offsets.shrink(0);
+            isNewTransition.shrink(0);
+        }
+
+        Vector<UniquedStringImpl*, 8> keys;
+        Vector<Structure*, 8> structures;
+        Vector<PropertyOffset, 8> offsets;
+        Vector<bool, 8> isNewTransition;
+    };
+
+    CharacterType nextCharacter(unsigned& position)
+    {
+        if (m_next == m_index.size())
+            return 0;
+        position = m_index[m_next++];
+        return m_characters[position];
+    }
+
+    CharacterType peekCharacter() const
+    {
+        if (m_next == m_index.size())
+            return 0;
+        return m_characters[m_index[m_next]];
+    }
+
+    // A token other than a string must run up to white space, punctuation or the end.
+    bool endsToken(unsigned position) const
+    {
+        if (position == m_length)
+            return true;
+        CharacterType character = m_characters[position];
+        return character == ' ' || character == '\t' || character == '\n' || character == '\r'
+            || character == ',' || character == ':' || character == ']' || character == '}';
+    }
+
+    JSValue parseValue(unsigned depth)
+    {
+        unsigned position;
+        switch (nextCharacter(position)) {
+        case '{':
+            return parseObject(depth);
+        case '[':
+            return parseArray(depth);
+        case '"':
+            return parseString(position);
+        case 't':
+            return parseLiteral(position, "true", jsBoolean(true));
+        case 'f':
+            return parseLiteral(position, "false", jsBoolean(false));
+        case 'n':
+            return parseLiteral(position, "null", jsNull());
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return parseNumber(position);
+        default:
+            return JSValue();
+        }
+    }
+
+    template<unsigned literalSize>
+    JSValue parseLiteral(unsigned position, const char (&literal)[literalSize], JSValue value)
+    {
+        unsigned length = literalSize - 1;
+        if (m_length - position < length)
+            return JSValue();
+        for (unsigned i = 1; i < length; ++i) {
+            if (m_characters[position + i] != literal[i])
+                return JSValue();
+        }
+        if (!endsToken(position + length))
+            return JSValue();
+        return value;
+    }
+
+    JSValue parseNumber(unsigned position)
+    {
+        const CharacterType* start = m_characters + position;
+        const CharacterType* end = m_characters + m_length;
+        const CharacterType* ptr = start;
+        bool negative = *ptr == '-';
+        if (negative)
+            ++ptr;
+        const CharacterType* integerStart = ptr;
+        if (ptr == end || !isASCIIDigit(*ptr))
+            return JSValue();
+        if (*ptr++ != '0') {
+            while (ptr < end && isASCIIDigit(*ptr))
+                ++ptr;
+        }
+        const CharacterType* integerEnd = ptr;
+        if (ptr < end && *ptr == '.') {
+            if (++ptr == end || !isASCIIDigit(*ptr))
+                return JSValue();
+            while (ptr < end && isASCIIDigit(*ptr))
+                ++ptr;
+        }
+        if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+            if (++ptr < end && (*ptr == '+' || *ptr == '-'))
+                ++ptr;
+            if (ptr == end || !isASCIIDigit(*ptr))
+                return JSValue();
+            while (ptr < end && isASCIIDigit(*ptr))
+                ++ptr;
+        }
+        unsigned length = ptr - start;
+        if (!endsToken(position + length))
+            return JSValue();
+
+        // Integers of up to nine digits fit in an int32_t, so they need no conversion to double.
+        if (integerEnd == ptr && integerEnd - integerStart <= 9) {
+            int32_t value = 0;
+            for (const CharacterType* digit = integerStart; digit < integerEnd; ++digit)
+                value = value * 10 + (*digit - '0');
+            if (negative)
+                return value ? jsNumber(-value) : jsNumber(-0.0);
+            return jsNumber(value);
+        }
+
+        size_t parsedLength;
+        double value = parseDouble(start, length, parsedLength);
+        if (parsedLength != length)
+            return JSValue();
+        return jsNumber(value);
+    }
+
+    // Takes the closing quote that the index always has right after an opening one, and gives the
+    // bounds of the string between them.
+    void stringBounds(unsigned openingQuote, const CharacterType*& start, const CharacterType*& end)
+    {
+        unsigned closingQuote = m_index[m_next++];
+        ASSERT(m_characters[closingQuote] == '"');
+        start = m_characters + openingQuote + 1;
+        end = m_characters + closingQuote;
+    }
+
+    static bool hasEscape(const LChar* start, const LChar* end)
+    {
+        return !!memchr(start, '\\', end - start);
+    }
+
+    static bool hasEscape(const UChar* start, const UChar* end)
+    {
+        for (const UChar* ptr = start; ptr < end; ++ptr) {
+            if (*ptr == '\\')
+                return true;
+        }
+        return false;
+    }
+
+    static bool unescape(const CharacterType* ptr, const CharacterType* end, StringBuilder& builder)
+    {
+        while (ptr < end) {
+            const CharacterType* run = ptr;
+            while (ptr < end && *ptr != '\\')
+                ++ptr;
+            builder.append(run, ptr - run);
+            if (ptr == end)
+                return true;
+
+            // The index never ends a string on an escaped quote, so a backslash is never last.
+            ++ptr;
+            switch (*ptr++) {
+            case '"':
+                builder.append('"');
+                break;
+            case '\\':
+                builder.append('\\');
+                break;
+            case '/':
+                builder.append('/');
+                break;
+            case 'b':
+                builder.append('\b');
+                break;
+            case 'f':
+                builder.append('\f');
+                break;
+            case 'n':
+                builder.append('\n');
+                break;
+            case 'r':
+                builder.append('\r');
+                break;
+            case 't':
+                builder.append('\t');
+                break;
+            case 'u':
+                if (end - ptr < 4 || !isASCIIHexDigit(ptr[0]) || !isASCIIHexDigit(ptr[1]) || !isASCIIHexDigit(ptr[2]) || !isASCIIHexDigit(ptr[3]))
+                    return false;
+                builder.append(static_cast<UChar>((toASCIIHexValue(ptr[0], ptr[1]) << 8) | toASCIIHexValue(ptr[2], ptr[3])));
+                ptr += 4;
+                break;
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    JSValue parseString(unsigned openingQuote)
+    {
+        const CharacterType* start;
+        const CharacterType* end;
+        stringBounds(openingQuote, start, end);
+        if (!hasEscape(start, end))
+            return jsString(&m_vm, String(start, end - start));
+        StringBuilder builder;
+        if (!unescape(start, end, builder))
+            return JSValue();
+        return jsString(&m_vm, builder.toString());
+    }
+
+    bool parseKey(unsigned openingQuote, Identifier& key)
+    {
+        const CharacterType* start;
+        const CharacterType* end;
+        stringBounds(openingQuote, start, end);
+        if (!hasEscape(start, end)) {
+            key = Identifier::fromString(&m_vm, start, end - start);
+            return true;
+        }
+        StringBuilder builder;
+        if (!unescape(start, end, builder))
+            return false;
+        key = Identifier::fromString(&m_vm, builder.toString());
+        return true;
+    }
+
+    JSValue parseArray(unsigned depth)
+    {
+        if (depth >= maximumDepth || !m_vm.isSafeToRecurse())
+            return JSValue();
+        unsigned position;
+        if (peekCharacter() == ']') {
+            nextCharacter(position);
+            return constructEmptyArray(m_exec, nullptr);
+        }
+
+        MarkedArgumentBuffer elements;
+        while (true) {
+            JSValue element = parseValue(depth + 1);
+            if (!element)
+                return JSValue();
+            elements.append(element);
+
+            CharacterType character = nextCharacter(position);
+            if (character == ']')
+                break;
+            if (character != ',')
+                return JSValue();
+        }
+        return constructArray(m_exec, static_cast<ArrayAllocationProfile*>(nullptr), elements);
+    }
+
+    JSValue parseObject(unsigned depth)
+    {
+        if (depth >= maximumDepth || !m_vm.isSafeToRecurse())
+            return JSValue();
+        unsigned position;
+        if (peekCharacter() == '}') {
+            nextCharacter(position);
+            return constructEmptyObject(m_exec);
+        }
+
+        Vector<Identifier, 8> keys;
+        MarkedArgumentBuffer values;
+        while (true) {
+            if (nextCharacter(position) != '"')
+                return JSValue();
+            Identifier key;
+            if (!parseKey(position, key))
+                return JSValue();
+            if (nextCharacter(position) != ':')
+                return JSValue();
+            JSValue value = parseValue(depth + 1);
+            if (!value)
+                return JSValue();
+            keys.append(key);
+            values.append(value);
+
+            CharacterType character = nextCharacter(position);
+            if (character == '}')
+                break;
+            if (character != ',')
+                return JSValue();
+        }
+        return createObject(keys, values);
+    }
+
+    JSObject* createObject(const Vector<Identifier, 8>& keys, const MarkedArgumentBuffer& values)
+    {
+        // A shape built on a miss is held only by this cache until the object below uses it, and
+        // no collection may see the object before all of its slots are filled in.
+        DeferGC deferGC(m_vm.heap);
+
+        if (ObjectShape* shape = shapeFor(keys)) {
+            for (unsigned i = 0; i < keys.size(); ++i) {
+                if (shape->isNewTransition[i]) {
+                    shape->structures[i]->willStoreValueForNewTransition(m_vm, keys[i], values.at(i), false);
+                    shape->isNewTransition[i] = false;
+                } else
+                    shape->structures[i]->willStoreValueForExistingTransition(m_vm, keys[i], values.at(i), false);
+            }
+
+            Structure* structure = shape->structures.last();
+            Butterfly* butterfly = structure->outOfLineCapacity() ? Butterfly::create(m_vm, nullptr, structure) : nullptr;
+            JSObject* object = JSFinalObject::create(m_exec, structure, butterfly);
+            for (unsigned i = 0; i < keys.size(); ++i)
+                object->putDirect(m_vm, shape->offsets[i], values.at(i));
+            return object;
+        }
+
+        // Duplicate and index-like keys, and key lists too long to stay out of dictionary mode,
+        // take the same path as LiteralParser.
+        JSObject* object = constructEmptyObject(m_exec);
+        for (unsigned i = 0; i < keys.size(); ++i) {
+            if (Optional<uint32_t> index = parseIndex(keys[i]))
+                object->putDirectIndex(m_exec, index.value(), values.at(i));
+            else
+                object->putDirect(m_vm, keys[i], values.at(i));
+        }
+        return object;
+    }
+
+    // Returns the cached shape for these keys, building it on a miss, or null if objects with these
+    // keys cannot share a Structure. The cache is direct mapped on a hash of the key list. Once a
+    // shape has been used, the object built from it keeps its whole transition chain alive for the
+    // rest of the parse.
+    ObjectShape* shapeFor(const Vector<Identifier, 8>& keys)
+    {
+        unsigned hash = keys.size();
+        for (const Identifier& key : keys)
+            hash = WTF::pairIntHash(hash, key.impl()->hash());
+        ObjectShape& shape = m_shapes[hash % shapeCacheSize];
+
+        if (shape.keys.size() == keys.size()) {
+            bool matches = true;
+            for (unsigned i = 0; i < keys.size() && matches; ++i)
+                matches = shape.keys[i] == keys[i].impl();
+            if (matches)
+                return &shape;
+        }
+
+        shape.clear();
+        Structure* structure = m_exec->lexicalGlobalObject()->objectStructureForObjectConstructor();
+        for (const Identifier& key : keys) {
+            if (parseIndex(key) || structure->get(m_vm, key) != invalidOffset)
+                break;
+            PropertyOffset offset;
+            Structure* next = Structure::addPropertyTransitionToExistingStructure(structure, key, 0, offset);
+            bool isNewTransition = !next;
+            if (isNewTransition)
+                next = Structure::addPropertyTransition(m_vm, structure, key, 0, offset);
+            structure = next;
+            if (structure->isDictionary())
+                break;
+            shape.keys.append(key.impl());
+            shape.structures.append(structure);
+            shape.offsets.append(offset);
+            shape.isNewTransition.append(isNewTransition);
+        }
+        if (shape.keys.size() != keys.size()) {
+            shape.clear();
+            return nullptr;
+        }
+        return &shape;
+    }
+
+    ExecState* m_exec;
+    VM& m_vm;
+    const CharacterType* m_characters;
+    unsigned m_length;
+    JSONStructuralIndex m_index;
+    unsigned m_next { 0 };
+    std::array<ObjectShape, shapeCacheSize> m_shapes;
+};
+
+// Inputs shorter than this are not worth indexing up front.
+static const unsigned minimumLengthForJSONStructuralParser = 1024;
+
+inline JSValue tryJSONParseWithStructuralIndex(ExecState* exec, const String& json)
+{
+    if (json.length() < minimumLengthForJSONStructuralParser)
+        return JSValue();
+    if (json.is8Bit())
+        return JSONStructuralParser<LChar>::tryParse(exec, json.characters8(), json.length());
+    return JSONStructuralParser<UChar>::tryParse(exec, json.characters16(), json.length());
+}
+
+// Drop-in replacement for JSONParse(): the same result, or the empty value for malformed input.
+// Nothing in the framework calls this yet; JSON.parse and JSValueMakeFromJSONString() still go
+// straight to LiteralParser. An embedder using the C API can call it the way
+// JSValueMakeFromJSONString() calls JSONParse():
+//
+//    ExecState* exec = toJS(context);
+//    JSLockHolder locker(exec);
+//    JSValue result = JSONParseWithStructuralIndex(exec, string->string());
+//    return result ? toRef(exec, result) : nullptr;
+//
+// There is no reviver argument. JSON.parse's reviver walk is internal to JSONObject.cpp, so to use
+// a reviver, call the JSON.parse function itself, or walk the result returned here.
+inline JSValue JSONParseWithStructuralIndex(ExecState* exec, const String& json)
+{
+    if (JSValue result = tryJSONParseWithStructuralIndex(exec, json))
+        return result;
+    return JSONParse(exec, json);
+}
+
+} // namespace JSC
+
+#endif // JSONStructuralParser_h
@@ -23,6 +23,7 @@
 #ifndef Lexer_h
 #define Lexer_h
 
+#include "LexerCharacterScanning.h"
 #include "Lookup.h"
 #include "ParserArena.h"
 #include "ParserTokens.h"
@@ -341,18 +342,13 @@ ALWAYS_INLINE JSTokenType Lexer<T>::lexExpectIdentifier(JSToken* tokenRecord, un
         ASSERT(ptr == end);
         goto slowCase;
     }
-    if (!WTF::isASCIIAlpha(*ptr))
+    if (!WTF::isASCIIAlpha(*ptr) && *ptr != '_' && *ptr != '$')
         goto slowCase;
-    ++ptr;
-    while (ptr < end) {
-        if (!WTF::isASCIIAlphanumeric(*ptr))
-            break;
-        ++ptr;
-    }
+    ptr = scanIdentifierPart(ptr + 1, end);
 
     // Here's the shift
     if (ptr < end) {
-        if ((!WTF::isASCII(*ptr)) || (*ptr == '\\') || (*ptr == '_') || (*ptr == '$'))
+        if ((!WTF::isASCII(*ptr)) || (*ptr == '\\'))
             goto slowCase;
         m_current = *ptr;
     } else
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef LexerCharacterScanning_h
+#define LexerCharacterScanning_h
+
+#include <wtf/ASCIICType.h>
+#include <wtf/text/LChar.h>
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace JSC {
+
+// Helpers for the lexer's hot loops. Each scanner returns a pointer to the first character at or
+// after ptr that ends the run it scans, or end if the run reaches the end of the source. With SSE2,
+// they classify 32 LChars or 16 UChars per iteration; elsewhere, and for the tail, they fall back
+// to one character at a time. They only recognize ASCII, plus U+2028 and U+2029 as line
+// terminators, so callers must still handle whatever non-ASCII character they stop on.
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+template<typename CharacterType> struct LexerCharacterLanes;
+
+template<> struct LexerCharacterLanes<LChar> {
+    static const unsigned count = 16;
+    static const unsigned allLanes = 0xFFFF;
+
+    static __m128i load(const LChar* characters) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters)); }
+    static __m128i splat(LChar character) { return _mm_set1_epi8(static_cast<char>(character)); }
+    static __m128i equal(__m128i characters, LChar character) { return _mm_cmpeq_epi8(characters, splat(character)); }
+
+    // The comparison is signed, so characters above 0x7F never fall in an ASCII range.
+    static __m128i inRange(__m128i characters, LChar low, LChar high)
+    {
+        return _mm_and_si128(_mm_cmpgt_epi8(characters, splat(low - 1)), _mm_cmplt_epi8(characters, splat(high + 1)));
+    }
+
+    static __m128i isLineSeparator(__m128i) { return _mm_setzero_si128(); }
+    static unsigned mask(__m128i lanes) { return _mm_movemask_epi8(lanes); }
+    static unsigned firstIndex(unsigned mask) { return __builtin_ctz(mask); }
+};
+
+template<> struct LexerCharacterLanes<UChar> {
+    static const unsigned count = 8;
+    static const unsigned allLanes = 0xFFFF;
+
+    static __m128i load(const UChar* characters) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters)); }
+    static __m128i splat(UChar character) { return _mm_set1_epi16(static_cast<short>(character)); }
+    static __m128i equal(__m128i characters, UChar character) { return _mm_cmpeq_epi16(characters, splat(character)); }
+
+    // The comparison is signed, but characters from 0x8000 up are negative and characters from
+    // 0x80 to 0x7FFF are above any ASCII bound, so neither falls in an ASCII range.
+    static __m128i inRange(__m128i characters, UChar low, UChar high)
+    {
+        return _mm_and_si128(_mm_cmpgt_epi16(characters, splat(low - 1)), _mm_cmplt_epi16(characters, splat(high + 1)));
+    }
+
+    static __m128i isLineSeparator(__m128i characters)
+    {
+        return _mm_cmpeq_epi16(_mm_and_si128(characters, splat(0xFFFE)), splat(0x2028));
+    }
+
+    // movemask yields two bits per 16-bit lane.
+    static unsigned mask(__m128i lanes) { return _mm_movemask_epi8(lanes); }
+    static unsigned firstIndex(unsigned mask) { return __builtin_ctz(mask) / 2; }
+};
+#endif
+
+template<typename CharacterType> inline bool isLexerLineSeparator(CharacterType);
+template<> inline bool isLexerLineSeparator(LChar) { return false; }
+template<> inline bool isLexerLineSeparator(UChar character) { return (character & ~1) == 0x2028; }
+
+template<typename CharacterType>
+struct LexerIdentifierPartClassifier {
+    // [A-Za-z0-9_$]
+    bool endsRun(CharacterType character) const
+    {
+        return !(isASCIIAlphanumeric(character) || character == '_' || character == '$');
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    unsigned endsRun(__m128i characters) const
+    {
+        typedef LexerCharacterLanes<CharacterType> Lanes;
+        // Setting bit 5 folds upper case onto lower case, and maps no other ASCII character into a-z.
+        __m128i matches = Lanes::inRange(_mm_or_si128(characters, Lanes::splat(0x20)), 'a', 'z');
+        matches = _mm_or_si128(matches, Lanes::inRange(characters, '0', '9'));
+        matches = _mm_or_si128(matches, Lanes::equal(characters, '_'));
+        matches = _mm_or_si128(matches, Lanes::equal(characters, '$'));
+        return ~Lanes::mask(matches) & Lanes::allLanes;
+    }
+#endif
+};
+
+template<typename CharacterType>
+struct LexerHorizontalWhiteSpaceClassifier {
+    // Space, tab, vertical tab and form feed. The lexer's other white space is rare enough to leave
+    // to the caller.
+    bool endsRun(CharacterType character) const
+    {
+        return !(character == ' ' || character == '\t' || character == 0xB || character == 0xC);
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    unsigned endsRun(__m128i characters) const
+    {
+        typedef LexerCharacterLanes<CharacterType> Lanes;
+        __m128i matches = _mm_andnot_si128(Lanes::equal(characters, '\n'), Lanes::inRange(characters, '\t', 0xC));
+        matches = _mm_or_si128(matches, Lanes::equal(characters, ' '));
+        return ~Lanes::mask(matches) & Lanes::allLanes;
+    }
+#endif
+};
+
+template<typename CharacterType>
+struct LexerLineTerminatorClassifier {
+    bool endsRun(CharacterType character) const
+    {
+        return character == '\n' || character == '\r' || isLexerLineSeparator(character);
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    unsigned endsRun(__m128i characters) const
+    {
+        typedef LexerCharacterLanes<CharacterType> Lanes;
+        return Lanes::mask(lineTerminators(characters));
+    }
+
+    static __m128i lineTerminators(__m128i characters)
+    {
+        typedef LexerCharacterLanes<CharacterType> Lanes;
+        __m128i matches = _mm_or_si128(Lanes::equal(characters, '\n'), Lanes::equal(characters, '\r'));
+        return _mm_or_si128(matches, Lanes::isLineSeparator(characters));
+    }
+#endif
+};
+
+template<typename CharacterType>
+struct LexerStringCharacterClassifier {
+    explicit LexerStringCharacterClassifier(CharacterType quote)
+        : quote(quote)
+    {
+    }
+
+    // The closing quote, an escape or a line terminator.
+    bool endsRun(CharacterType character) const
+    {
+        return character == quote || character == '\\' || LexerLineTerminatorClassifier<CharacterType>().endsRun(character);
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    unsigned endsRun(__m128i characters) const
+    {
+        typedef LexerCharacterLanes<CharacterType> Lanes;
+        __m128i matches = _mm_or_si128(Lanes::equal(characters, quote), Lanes::equal(characters, '\\'));
+        matches = _mm_or_si128(matches, LexerLineTerminatorClassifier<CharacterType>::lineTerminators(characters));
+        return Lanes::mask(matches);
+    }
+#endif
+
+    CharacterType quote;
+};
+
+template<typename CharacterType>
+struct LexerMultilineCommentClassifier {
+    // A '*' that may close the comment, or a line terminator that the caller must count.
+    bool endsRun(CharacterType character) const
+    {
+        return character == '*' || LexerLineTerminatorClassifier<CharacterType>().endsRun(character);
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    unsigned endsRun(__m128i characters) const
+    {
+        typedef LexerCharacterLanes<CharacterType> Lanes;
+        __m128i matches = _mm_or_si128(Lanes::equal(characters, '*'), LexerLineTerminatorClassifier<CharacterType>::lineTerminators(characters));
+        return Lanes::mask(matches);
+    }
+#endif
+};
+
+template<typename CharacterType, typename Classifier>
+ALWAYS_INLINE const CharacterType* scanLexerRun(const CharacterType* ptr, const CharacterType* end, const Classifier& classifier)
+{
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    typedef LexerCharacterLanes<CharacterType> Lanes;
+    while (static_cast<size_t>(end - ptr) >= 2 * Lanes::count) {
+        if (unsigned mask = classifier.endsRun(Lanes::load(ptr)))
+            return ptr + Lanes::firstIndex(mask);
+        if (unsigned mask = classifier.endsRun(Lanes::load(ptr + Lanes::count)))
+            return ptr + Lanes::count + Lanes::firstIndex(mask);
+        ptr += 2 * Lanes::count;
+    }
+    if (static_cast<size_t>(end - ptr) >= Lanes::count) {
+        if (unsigned mask = classifier.endsRun(Lanes::load(ptr)))
+            return ptr + Lanes::firstIndex(mask);
+        ptr += Lanes::count;
+    }
+#endif
+    while (ptr < end && !classifier.endsRun(*ptr))
+        ++ptr;
+    return ptr;
+}
+
+// Skips characters that may continue an ASCII identifier.
+template<typename CharacterType>
+ALWAYS_INLINE const CharacterType* scanIdentifierPart(const CharacterType* ptr, const CharacterType* end)
+{
+    return scanLexerRun(ptr, end, LexerIdentifierPartClassifier<CharacterType>());
+}
+
+template<typename CharacterType>
+ALWAYS_INLINE const CharacterType* scanHorizontalWhiteSpace(const CharacterType* ptr, const CharacterType* end)
+{
+    return scanLexerRun(ptr, end, LexerHorizontalWhiteSpaceClassifier<CharacterType>());
+}
+
+// Skips the body of a single line comment, stopping at the line terminator.
+template<typename CharacterType>
+ALWAYS_INLINE const CharacterType* scanSingleLineComment(const CharacterType* ptr, const CharacterType* end)
+{
+    return scanLexerRun(ptr, end, LexerLineTerminatorClassifier<CharacterType>());
+}
+
+template<typename CharacterType>
+ALWAYS_INLINE const CharacterType* scanMultilineComment(const CharacterType* ptr, const CharacterType* end)
+{
+    return scanLexerRun(ptr, end, LexerMultilineCommentClassifier<CharacterType>());
+}
+
+// Skips the characters of a string literal that need no further work. If this stops on the
+// closing quote, the literal has no escapes and can be made into an identifier straight from the
+// source, without going through the lexer's buffers.
+template<typename CharacterType>
+ALWAYS_INLINE const CharacterType* scanStringCharacters(const CharacterType* ptr, const CharacterType* end, CharacterType quote)
+{
+    return scanLexerRun(ptr, end, LexerStringCharacterClassifier<CharacterType>(quote));
+}
+
+} // namespace JSC
+
+#endif // LexerCharacterScanning_h
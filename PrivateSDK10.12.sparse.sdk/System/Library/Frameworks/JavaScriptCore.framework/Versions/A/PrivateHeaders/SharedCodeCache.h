@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef SharedCodeCache_h
+#define SharedCodeCache_h
+
+#include "BytecodeCache.h"
+#include "Identifier.h"
+#include <wtf/LRUCache.h>
+#include <wtf/NeverDestroyed.h>
+#include <wtf/ThreadSafeRefCounted.h>
+
+namespace JSC {
+
+class VM;
+
+// Encoded top-level code, immutable once created, that any VM in the process may decode. Unlinked
+// code blocks are cells in one VM's heap and cannot be handed to another VM, so this is what VMs
+// share instead: decoding builds a fresh UnlinkedCodeBlock for the decoding VM, which is much
+// cheaper than lexing, parsing and generating bytecode again.
+class SharedCodeBlock : public ThreadSafeRefCounted<SharedCodeBlock> {
+public:
+    static Ref<SharedCodeBlock> create(const Vector<uint8_t>& codeBlock, const Vector<Vector<uint8_t>>& functions)
+    {
+        return adoptRef(*new SharedCodeBlock(BytecodeCachePayload::encode(codeBlock, functions)));
+    }
+
+    size_t sizeInBytes() const { return m_bytes.size(); }
+
+    BytecodeDecoder codeBlock() const { return m_payload.codeBlock(); }
+    unsigned functionCount() const { return m_payload.functionCount(); }
+    BytecodeDecoder function(unsigned index) const { return m_payload.function(index); }
+
+private:
+    explicit SharedCodeBlock(Vector<uint8_t>&& bytes)
+        : m_bytes(WTFMove(bytes))
+        , m_payload(BytecodeCachePayload::parse(m_bytes.data(), m_bytes.size()).value())
+    {
+    }
+
+    Vector<uint8_t> m_bytes;
+    BytecodeCachePayload m_payload;
+};
+
+// An opt-in process-wide store of SharedCodeBlocks. It is not consulted by CodeCache: that needs
+// UnlinkedCodeBlock serialization, which does not exist, so only embedders that encode their own
+// blocks can use it. All callers draw on one memory budget, spent least recently used first. Safe
+// to use from any thread.
+class SharedCodeCache {
+    WTF_MAKE_NONCOPYABLE(SharedCodeCache);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    struct Configuration {
+        bool isEnabled { false };
+        size_t maxBytes { 64 * MB };
+    };
+
+    // Set before the first call to singletonIfEnabled(). maxBytes is only read when the singleton
+    // is created.
+    static Configuration& configuration()
+    {
+        static Configuration configuration;
+        return configuration;
+    }
+
+    static SharedCodeCache* singletonIfEnabled()
+    {
+        if (!configuration().isEnabled)
+            return nullptr;
+        return &singleton();
+    }
+
+    static SharedCodeCache& singleton()
+    {
+        static NeverDestroyed<SharedCodeCache> cache(configuration().maxBytes);
+        return cache;
+    }
+
+    explicit SharedCodeCache(size_t maxBytes)
+        : m_cache(maxBytes)
+    {
+    }
+
+    RefPtr<SharedCodeBlock> find(const BytecodeCacheKey& key)
+    {
+        if (Optional<RefPtr<SharedCodeBlock>> result = m_cache.get(key))
+            return result.value();
+        return nullptr;
+    }
+
+    // Returns the block that is cached for the key from now on. When two VMs compile the same code
+    // concurrently, the first to publish wins and the other adopts its block, so that the process
+    // converges on one copy.
+    Ref<SharedCodeBlock> add(const BytecodeCacheKey& key, Ref<SharedCodeBlock>&& block)
+    {
+        Optional<RefPtr<SharedCodeBlock>> result = m_cache.ensure(key, [&] () -> RefPtr<SharedCodeBlock> {
+            return block.copyRef();
+        });
+        if (!result)
+            return WTFMove(block);
+        return result.value().releaseNonNull();
+    }
+
+    size_t sizeInBytes() { return m_cache.cost(); }
+
+    void clear() { m_cache.clear(); }
+
+private:
+    struct Policy : LRUCachePolicy<BytecodeCacheKey, RefPtr<SharedCodeBlock>> {
+        static size_t cost(const BytecodeCacheKey&, const RefPtr<SharedCodeBlock>& block) { return block->sizeInBytes(); }
+    };
+
+    // One shard, so that the budget is global: with more, each shard would evict against its own
+    // fraction of it. Lookups are rare next to compiling, so the single lock does not contend.
+    ShardedLRUCache<BytecodeCacheKey, RefPtr<SharedCodeBlock>, Policy, BytecodeCacheKey::Hash, BytecodeCacheKey::HashTraits, 1> m_cache;
+};
+
+// Identifiers travel between VMs as plain strings and are atomized again in the decoding VM's
+// identifier table. Private names only exist within one VM, so code that uses them cannot be shared.
+inline bool encodeIdentifier(BytecodeEncoder& encoder, const Identifier& identifier)
+{
+    if (identifier.isSymbol())
+        return false;
+    encoder.encodeString(identifier.string());
+    return true;
+}
+
+inline bool decodeIdentifier(BytecodeDecoder& decoder, VM& vm, Identifier& identifier)
+{
+    String string;
+    if (!decoder.decodeString(string))
+        return false;
+    identifier = string.isNull() ? Identifier() : Identifier::fromString(&vm, string);
+    return true;
+}
+
+} // namespace JSC
+
+#endif // SharedCodeCache_h
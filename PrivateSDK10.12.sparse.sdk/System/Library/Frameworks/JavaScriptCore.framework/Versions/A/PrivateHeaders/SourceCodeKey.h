@@ -56,6 +56,8 @@ public:
         return m_flags == rhs.m_flags;
     }
 
+    unsigned bits() const { return m_flags; }
+
 private:
     unsigned m_flags { 0 };
 };
@@ -91,6 +93,9 @@ public:
     // providers cache their strings to make this efficient.
     StringView string() const { return m_sourceCode.view(); }
 
+    const String& name() const { return m_name; }
+    SourceCodeFlags flags() const { return m_flags; }
+
     bool operator==(const SourceCodeKey& other) const
     {
         return m_hash == other.m_hash
@@ -27,6 +27,8 @@
 #define Allocator_h
 
 #include "BumpAllocator.h"
+#include "Heap.h"
+#include "PerProcess.h"
 #include <array>
 
 namespace bmalloc {
@@ -45,6 +47,7 @@ public:
     void* allocate(size_t);
     void* allocate(size_t alignment, size_t);
     void* reallocate(void*, size_t);
+    void allocateBatch(size_t, size_t count, void** objects);
 
     void scavenge();
 
@@ -86,6 +89,44 @@ inline void* Allocator::allocate(size_t size)
     return object;
 }
 
+// Fills objects with count objects of the given size. Small sizes bypass the
+// per-object fast path: after draining this cache, we hold the heap lock
+// once and expand fresh bump ranges straight into the caller's array.
+inline void Allocator::allocateBatch(size_t size, size_t count, void** objects)
+{
+    if (!m_isBmallocEnabled || size > smallMax) {
+        for (size_t i = 0; i < count; ++i)
+            objects[i] = allocate(size);
+        return;
+    }
+
+    size_t sizeClass = bmalloc::sizeClass(size);
+    BumpAllocator& allocator = m_bumpAllocators[sizeClass];
+    BumpRangeCache& rangeCache = m_bumpRangeCaches[sizeClass];
+
+    size_t i = 0;
+    auto drain = [&]() {
+        while (i < count) {
+            while (i < count && allocator.canAllocate())
+                objects[i++] = allocator.allocate();
+            if (i == count || rangeCache.isEmpty())
+                return;
+            allocator.refill(rangeCache.pop());
+        }
+    };
+
+    drain();
+    if (i == count)
+        return;
+
+    std::lock_guard<StaticMutex> lock(PerProcess<Heap>::mutex());
+    Heap* heap = PerProcess<Heap>::getFastCase();
+    while (i < count) {
+        heap->allocateSmallBumpRanges(lock, sizeClass, allocator, rangeCache);
+        drain();
+    }
+}
+
 } // namespace bmalloc
 
 #endif // Allocator_h
@@ -43,7 +43,10 @@ public:
     static void* allocate(size_t);
     static void* allocate(size_t alignment, size_t);
     static void deallocate(void*);
+    static void deallocateSized(void*, size_t);
     static void* reallocate(void*, size_t);
+    static void allocateBatch(size_t, size_t count, void** objects);
+    static void deallocateBatch(void* const* objects, size_t count);
 
     static void scavenge();
 
@@ -95,6 +98,14 @@ inline void Cache::deallocate(void* object)
     return cache->deallocator().deallocate(object);
 }
 
+inline void Cache::deallocateSized(void* object, size_t size)
+{
+    Cache* cache = PerThread<Cache>::getFastCase();
+    if (!cache)
+        return deallocateSlowCaseNullCache(object);
+    return cache->deallocator().deallocateSized(object, size);
+}
+
 inline void* Cache::reallocate(void* object, size_t newSize)
 {
     Cache* cache = PerThread<Cache>::getFastCase();
@@ -103,6 +114,16 @@ inline void* Cache::reallocate(void* object, size_t newSize)
     return cache->allocator().reallocate(object, newSize);
 }
 
+inline void Cache::allocateBatch(size_t size, size_t count, void** objects)
+{
+    PerThread<Cache>::get()->allocator().allocateBatch(size, count, objects);
+}
+
+inline void Cache::deallocateBatch(void* const* objects, size_t count)
+{
+    PerThread<Cache>::get()->deallocator().deallocateBatch(objects, count);
+}
+
 } // namespace bmalloc
 
 #endif // Cache_h
@@ -27,6 +27,8 @@
 #define Deallocator_h
 
 #include "FixedVector.h"
+#include "Heap.h"
+#include "PerProcess.h"
 #include <mutex>
 
 namespace bmalloc {
@@ -42,6 +44,8 @@ public:
     ~Deallocator();
 
     void deallocate(void*);
+    void deallocateSized(void*, size_t);
+    void deallocateBatch(void* const* objects, size_t count);
     void scavenge();
     
     void processObjectLog();
@@ -50,6 +54,7 @@ public:
 private:
     bool deallocateFastCase(void*);
     void deallocateSlowCase(void*);
+    void flushObjectLog();
 
     FixedVector<void*, deallocatorLogCapacity> m_objectLog;
     bool m_isBmallocEnabled;
@@ -68,10 +73,90 @@ inline bool Deallocator::deallocateFastCase(void* object)
     return true;
 }
 
+// Empties the object log without waiting for the heap lock. If another thread
+// holds it, the log goes to the DeferredFreeQueue and whoever takes the lock
+// next frees it for us.
+inline void Deallocator::flushObjectLog()
+{
+    StaticMutex& mutex = PerProcess<Heap>::mutex();
+    if (!mutex.try_lock()) {
+        PerProcess<DeferredFreeQueue>::get()->push(m_objectLog.begin(), m_objectLog.end());
+        m_objectLog.clear();
+        return;
+    }
+
+    std::lock_guard<StaticMutex> lock(mutex, std::adopt_lock);
+    PerProcess<DeferredFreeQueue>::get()->didFreeDirectly(m_objectLog.size());
+    processObjectLog(lock);
+    PerProcess<Heap>::get()->processDeferredFrees(lock);
+}
+
 inline void Deallocator::deallocate(void* object)
 {
-    if (!deallocateFastCase(object))
-        deallocateSlowCase(object);
+    if (deallocateFastCase(object))
+        return;
+
+    // A small object only misses the fast case when the log is full.
+    if (!mightBeLarge(object) && m_isBmallocEnabled) {
+        flushObjectLog();
+        m_objectLog.push(object);
+        return;
+    }
+
+    deallocateSlowCase(object);
+}
+
+// A known small size proves the object is small, so unlike deallocate() we
+// never have to ask the heap whether an object on a largeAlignment boundary
+// is in m_largeAllocated.
+inline void Deallocator::deallocateSized(void* object, size_t size)
+{
+    if (size > smallMax || !object || !m_isBmallocEnabled)
+        return deallocate(object);
+
+    // A wrong size would send a large object down the small path and corrupt
+    // the heap. The page's size class may be bigger than size needs, since
+    // reallocate() keeps an object that shrinks in place.
+    BASSERT(objectSize(Object(object).page()->sizeClass()) >= size);
+
+    if (m_objectLog.size() == m_objectLog.capacity())
+        flushObjectLog();
+
+    m_objectLog.push(object);
+}
+
+// Small objects are appended to the object log in one step when they fit.
+// Otherwise the log is flushed as often as it fills, once per
+// deallocatorLogCapacity objects rather than once per object.
+inline void Deallocator::deallocateBatch(void* const* objects, size_t count)
+{
+    void* const* end = objects + count;
+
+    if (!m_isBmallocEnabled) {
+        for (void* const* it = objects; it != end; ++it)
+            deallocateSlowCase(*it);
+        return;
+    }
+
+    if (count <= m_objectLog.capacity() - m_objectLog.size()) {
+        bool hasLarge = false;
+        for (void* const* it = objects; it != end; ++it)
+            hasLarge |= mightBeLarge(*it);
+        if (!hasLarge) {
+            m_objectLog.push(objects, end);
+            return;
+        }
+    }
+
+    for (void* const* it = objects; it != end; ++it) {
+        if (mightBeLarge(*it)) {
+            deallocateSlowCase(*it);
+            continue;
+        }
+        if (m_objectLog.size() == m_objectLog.capacity())
+            flushObjectLog();
+        m_objectLog.push(*it);
+    }
 }
 
 } // namespace bmalloc
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef DeferredFreeQueue_h
+#define DeferredFreeQueue_h
+
+#include "BAssert.h"
+#include "Sizes.h"
+#include "StaticMutex.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace bmalloc {
+
+// A lock-free list of freed small objects that are waiting for
+// PerProcess<Heap>::mutex(). When a thread's object log fills up while another
+// thread holds the heap lock, it pushes the whole log here with one
+// compare-and-swap instead of waiting. The next thread that takes the lock
+// dereferences the objects' lines. Links are stored in the freed objects
+// themselves, so the queue never allocates.
+
+class DeferredFreeQueue {
+public:
+    struct Node {
+        Node* next;
+    };
+
+    DeferredFreeQueue(std::lock_guard<StaticMutex>&);
+
+    bool isEmpty() { return !m_head.load(std::memory_order_relaxed); }
+
+    void push(void* const* begin, void* const* end);
+
+    // Detaches every queued object and calls function on each. The caller
+    // must hold PerProcess<Heap>::mutex().
+    template<typename Function> void takeAll(const Function&);
+
+    // Object log flushes that found the heap lock free, and flushes that
+    // were pushed here instead, counted in objects.
+    void didFreeDirectly(size_t count) { m_directFreeCount.fetch_add(count, std::memory_order_relaxed); }
+    size_t directFreeCount() { return m_directFreeCount.load(std::memory_order_relaxed); }
+    size_t deferredFreeCount() { return m_deferredFreeCount.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<Node*> m_head;
+    std::atomic<size_t> m_directFreeCount;
+    std::atomic<size_t> m_deferredFreeCount;
+};
+
+static_assert(sizeof(DeferredFreeQueue::Node) <= alignment, "freed objects must be able to hold a DeferredFreeQueue link");
+
+inline DeferredFreeQueue::DeferredFreeQueue(std::lock_guard<StaticMutex>&)
+    : m_head(nullptr)
+    , m_directFreeCount(0)
+    , m_deferredFreeCount(0)
+{
+}
+
+inline void DeferredFreeQueue::push(void* const* begin, void* const* end)
+{
+    if (begin == end)
+        return;
+
+    // Chain the objects privately, then publish the chain in one step.
+    Node* first = static_cast<Node*>(*begin);
+    Node* last = first;
+    for (void* const* it = begin + 1; it != end; ++it) {
+        Node* node = static_cast<Node*>(*it);
+        last->next = node;
+        last = node;
+    }
+
+    Node* head = m_head.load(std::memory_order_relaxed);
+    do {
+        last->next = head;
+    } while (!m_head.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+
+    m_deferredFreeCount.fetch_add(end - begin, std::memory_order_relaxed);
+}
+
+template<typename Function>
+inline void DeferredFreeQueue::takeAll(const Function& function)
+{
+    if (isEmpty())
+        return;
+
+    Node* node = m_head.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        // Read the link first: function may recycle the object's memory.
+        Node* next = node->next;
+        function(static_cast<void*>(node));
+        node = next;
+    }
+}
+
+} // namespace bmalloc
+
+#endif // DeferredFreeQueue_h
@@ -26,6 +26,8 @@
 #ifndef Environment_h
 #define Environment_h
 
+#include <cstdlib>
+
 namespace bmalloc {
 
 class Environment {
@@ -34,6 +36,11 @@ public:
     
     bool isBmallocEnabled() { return m_isBmallocEnabled; }
 
+    // Opt in by setting MallocHugePageChunks. Read on each call rather than
+    // stored, since Environment is constructed out of line and only a new
+    // small chunk consults it.
+    static bool isHugePageChunksEnabled() { return !!getenv("MallocHugePageChunks"); }
+
 private:
     bool computeIsBmallocEnabled();
 
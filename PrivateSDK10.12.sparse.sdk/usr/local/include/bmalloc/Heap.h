@@ -28,12 +28,15 @@
 
 #include "AsyncTask.h"
 #include "BumpRange.h"
+#include "DeferredFreeQueue.h"
 #include "Environment.h"
+#include "HeapStatistics.h"
 #include "LineMetadata.h"
 #include "List.h"
 #include "Map.h"
 #include "Mutex.h"
 #include "Object.h"
+#include "PerProcess.h"
 #include "SmallLine.h"
 #include "SmallPage.h"
 #include "VMHeap.h"
@@ -56,6 +59,7 @@ public:
 
     void allocateSmallBumpRanges(std::lock_guard<StaticMutex>&, size_t sizeClass, BumpAllocator&, BumpRangeCache&);
     void derefSmallLine(std::lock_guard<StaticMutex>&, Object);
+    void processDeferredFrees(std::lock_guard<StaticMutex>&);
 
     void* allocateLarge(std::lock_guard<StaticMutex>&, size_t alignment, size_t);
     void* tryAllocateLarge(std::lock_guard<StaticMutex>&, size_t alignment, size_t);
@@ -67,6 +71,8 @@ public:
 
     void scavenge(std::unique_lock<StaticMutex>&, std::chrono::milliseconds sleepDuration);
 
+    void collectStatistics(std::lock_guard<StaticMutex>&, HeapStatistics&);
+
 private:
     struct LargeObjectHash {
         static unsigned hash(void* key)
@@ -136,6 +142,57 @@ inline void Heap::derefSmallLine(std::lock_guard<StaticMutex>& lock, Object obje
     deallocateSmallLine(lock, object);
 }
 
+// Frees that other threads queued because they found the heap lock taken.
+inline void Heap::processDeferredFrees(std::lock_guard<StaticMutex>& lock)
+{
+    PerProcess<DeferredFreeQueue>::get()->takeAll([&](void* object) {
+        derefSmallLine(lock, object);
+    });
+}
+
+// Walks the free lists under the heap lock, so the cost grows with the number
+// of partly used and free pages, not with the number of objects.
+inline void Heap::collectStatistics(std::lock_guard<StaticMutex>& lock, HeapStatistics& statistics)
+{
+    for (size_t sizeClass = 0; sizeClass < sizeClassCount; ++sizeClass) {
+        HeapStatistics::SizeClass& result = statistics.sizeClasses[sizeClass];
+        size_t lineCount = pageSize(m_pageClasses[sizeClass]) / smallLineSize;
+        result.objectSize = objectSize(sizeClass);
+        result.pagesWithFreeLines = 0;
+        result.freeLineBytes = 0;
+        m_smallPagesWithFreeLines[sizeClass].forEach([&](SmallPage* page) {
+            ++result.pagesWithFreeLines;
+            SmallLine* lines = page->begin();
+            for (size_t i = 0; i < lineCount; ++i) {
+                if (!lines[i].refCount(lock))
+                    result.freeLineBytes += smallLineSize;
+            }
+        });
+    }
+
+    for (size_t pageClass = 0; pageClass < pageClassCount; ++pageClass) {
+        HeapStatistics::PageClass& result = statistics.pageClasses[pageClass];
+        result.pageSize = pageSize(pageClass);
+        result.freePages = m_smallPages[pageClass].count();
+        result.decommittedPages = m_vmHeap.smallPageCount(lock, pageClass);
+    }
+
+    statistics.largeObjectCount = m_largeAllocated.size();
+    statistics.largeFreeRangeCount = m_largeFree.ranges().size();
+    statistics.largeFreeBytes = 0;
+    statistics.largeFreePhysicalBytes = 0;
+    statistics.largestLargeFreeRange = 0;
+    for (auto& range : m_largeFree.ranges()) {
+        statistics.largeFreeBytes += range.size();
+        statistics.largeFreePhysicalBytes += range.physicalSize();
+        statistics.largestLargeFreeRange = std::max(statistics.largestLargeFreeRange, range.size());
+    }
+
+    DeferredFreeQueue* deferredFreeQueue = PerProcess<DeferredFreeQueue>::get();
+    statistics.directFreeCount = deferredFreeQueue->directFreeCount();
+    statistics.deferredFreeCount = deferredFreeQueue->deferredFreeCount();
+}
+
 } // namespace bmalloc
 
 #endif // Heap_h
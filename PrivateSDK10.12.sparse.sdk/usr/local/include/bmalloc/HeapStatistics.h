@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef HeapStatistics_h
+#define HeapStatistics_h
+
+#include "Sizes.h"
+#include <array>
+#include <cstddef>
+
+namespace bmalloc {
+
+// A point-in-time summary of allocator state, as returned by api::stats().
+// Everything is read from the lists and maps that the heap itself maintains,
+// under the heap lock. Objects sitting in per-thread caches and object logs are
+// invisible to the heap, so there is no live byte count.
+
+struct HeapStatistics {
+    struct SizeClass {
+        size_t objectSize;
+        size_t pagesWithFreeLines;
+        size_t freeLineBytes; // Unreferenced lines on those pages, which the next refill hands out.
+    };
+
+    struct PageClass {
+        size_t pageSize;
+        size_t freePages; // Free and still committed, until the scavenger runs.
+        size_t decommittedPages; // Held by the VMHeap, including never touched pages of new chunks.
+    };
+
+    std::array<SizeClass, sizeClassCount> sizeClasses;
+    std::array<PageClass, pageClassCount> pageClasses;
+
+    size_t largeObjectCount;
+    size_t largeFreeRangeCount;
+    size_t largeFreeBytes;
+    size_t largeFreePhysicalBytes;
+    size_t largestLargeFreeRange;
+
+    // Small objects freed by object log flushes that got the heap lock, and
+    // small objects handed to the DeferredFreeQueue because it was taken.
+    size_t directFreeCount;
+    size_t deferredFreeCount;
+};
+
+} // namespace bmalloc
+
+#endif // HeapStatistics_h
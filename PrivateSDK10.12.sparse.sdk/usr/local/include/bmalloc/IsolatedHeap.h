@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. 
+ */
+
+#ifndef IsolatedHeap_h
+#define IsolatedHeap_h
+
+#include "List.h"
+#include "Map.h"
+#include "Mutex.h"
+#include "Sizes.h"
+#include "VMAllocate.h"
+#include <array>
+#include <mutex>
+#include <new>
+
+namespace bmalloc {
+
+// A named heap whose memory is never shared with the per-process Heap or with
+// other IsolatedHeaps. Objects must be freed against the heap that allocated
+// them. Destroying the heap releases every object it still holds by unmapping
+// its chunks, so a request-scoped heap can be dropped in O(chunks) without
+// freeing objects one by one.
+//
+// Small objects come from runs: a few contiguous small pages carved out of a
+// chunkSize-aligned chunk, holding objects of one size class on their own free
+// list. Each chunk begins with a header that maps its pages to their runs, so
+// free needs no per-object header. When a run's last object is freed, its
+// pages are decommitted and the run is kept for reuse by any size class of
+// the same run size. Large objects get their own chunkSize-aligned mapping,
+// which is how free tells them apart, and are found by address in a Map.
+//
+// Each heap has one lock and no per-thread cache. Heaps are meant to be
+// narrow, like one per request, so they see little contention.
+
+class IsolatedHeap {
+public:
+    static IsolatedHeap* create(const char* name);
+    static void destroy(IsolatedHeap*);
+
+    const char* name() { return m_name; }
+
+    void* tryAllocate(size_t);
+    void* allocate(size_t);
+    void deallocate(void*);
+
+    // Bytes of address space currently reserved from the OS, including the
+    // decommitted pages of empty runs.
+    size_t footprint();
+
+private:
+    static const size_t chunkPageCount = chunkSize / smallPageSize;
+
+    struct FreeObject {
+        FreeObject* next;
+    };
+
+    struct Run : public ListNode<Run> {
+        FreeObject* freeList { nullptr };
+        unsigned objectCount { 0 }; // Allocated and not yet freed.
+        unsigned char sizeClass { 0 };
+        unsigned char pageCount { 0 };
+    };
+
+    struct ChunkHeader {
+        IsolatedHeap* owner;
+        ChunkHeader* next;
+        std::array<unsigned short, chunkPageCount> firstPages; // The first page of each page's run.
+        std::array<Run, chunkPageCount> runs; // Indexed by each run's first page.
+    };
+
+    struct LargeObjectHash {
+        static unsigned hash(void* key)
+        {
+            return static_cast<unsigned>(reinterpret_cast<uintptr_t>(key) / chunkSize);
+        }
+    };
+
+    static size_t chunkHeaderSize() { return roundUpToMultipleOf<smallPageSize>(sizeof(ChunkHeader)); }
+
+    IsolatedHeap(const char* name);
+    ~IsolatedHeap();
+
+    static size_t runSize(size_t sizeClass);
+    static char* runBegin(Run*);
+
+    void* tryAllocateSmall(std::lock_guard<StaticMutex>&, size_t sizeClass);
+    void* tryAllocateLarge(std::lock_guard<StaticMutex>&, size_t);
+    Run* tryAllocateRun(std::lock_guard<StaticMutex>&, size_t sizeClass);
+    bool tryAllocateChunk(std::lock_guard<StaticMutex>&);
+    void deallocateSmall(std::lock_guard<StaticMutex>&, void*);
+
+    Mutex m_mutex;
+    const char* m_name;
+
+    ChunkHeader* m_chunks;
+    size_t m_chunkCount;
+    char* m_chunkBumpPointer;
+    char* m_chunkBumpEnd;
+
+    std::array<List<Run>, sizeClassCount> m_runsWithFreeObjects;
+    std::array<List<Run>, pageClassCount + 1> m_freeRuns; // Indexed by page count.
+
+    Map<void*, size_t, LargeObjectHash> m_largeObjects;
+    size_t m_largeObjectBytes;
+};
+
+static_assert(sizeClassCount <= std::numeric_limits<unsigned char>::max(), "Largest size class must fit in a Run");
+static_assert(pageClassCount <= std::numeric_limits<unsigned char>::max(), "Largest run must fit in a Run");
+
+// Map relies on zero-filled memory for its initial state, as Heap does in
+// PerProcess storage. vmAllocate() provides that.
+inline IsolatedHeap* IsolatedHeap::create(const char* name)
+{
+    void* memory = vmAllocate(vmSize(sizeof(IsolatedHeap)));
+    return new (memory) IsolatedHeap(name);
+}
+
+inline void IsolatedHeap::destroy(IsolatedHeap* heap)
+{
+    heap->~IsolatedHeap();
+    vmDeallocate(heap, vmSize(sizeof(IsolatedHeap)));
+}
+
+inline IsolatedHeap::IsolatedHeap(const char* name)
+    : m_name(name)
+    , m_chunks(nullptr)
+    , m_chunkCount(0)
+    , m_chunkBumpPointer(nullptr)
+    , m_chunkBumpEnd(nullptr)
+    , m_largeObjectBytes(0)
+{
+}
+
+inline IsolatedHeap::~IsolatedHeap()
+{
+    for (ChunkHeader* chunk = m_chunks; chunk;) {
+        ChunkHeader* next = chunk->next;
+        vmDeallocate(chunk, chunkSize);
+        chunk = next;
+    }
+
+    m_largeObjects.forEach([](void* object, size_t size) {
+        vmDeallocate(object, size);
+    });
+}
+
+inline size_t IsolatedHeap::footprint()
+{
+    std::lock_guard<StaticMutex> lock(m_mutex);
+    return m_chunkCount * chunkSize + m_largeObjectBytes;
+}
+
+// Big enough to waste at most 1 / pageSizeWasteFactor of a run on its tail.
+inline size_t IsolatedHeap::runSize(size_t sizeClass)
+{
+    size_t size = roundUpToMultipleOf<smallPageSize>(objectSize(sizeClass) * pageSizeWasteFactor);
+    return std::min(size, pageSizeMax);
+}
+
+inline char* IsolatedHeap::runBegin(Run* run)
+{
+    ChunkHeader* chunk = reinterpret_cast<ChunkHeader*>(mask(run, chunkMask));
+    size_t firstPage = run - chunk->runs.begin();
+    return reinterpret_cast<char*>(chunk) + firstPage * smallPageSize;
+}
+
+inline bool IsolatedHeap::tryAllocateChunk(std::lock_guard<StaticMutex>&)
+{
+    void* memory = tryVMAllocate(chunkSize, chunkSize);
+    if (!memory)
+        return false;
+
+    ChunkHeader* chunk = new (memory) ChunkHeader;
+    chunk->owner = this;
+    chunk->next = m_chunks;
+    m_chunks = chunk;
+    ++m_chunkCount;
+
+    m_chunkBumpPointer = static_cast<char*>(memory) + chunkHeaderSize();
+    m_chunkBumpEnd = static_cast<char*>(memory) + chunkSize;
+    return true;
+}
+
+inline IsolatedHeap::Run* IsolatedHeap::tryAllocateRun(std::lock_guard<StaticMutex>& lock, size_t sizeClass)
+{
+    size_t size = runSize(sizeClass);
+    size_t pageCount = size / smallPageSize;
+
+    Run* run;
+    char* begin;
+    if (!m_freeRuns[pageCount].isEmpty()) {
+        run = m_freeRuns[pageCount].pop();
+        begin = runBegin(run);
+        vmAllocatePhysicalPagesSloppy(begin, size);
+    } else {
+        if (static_cast<size_t>(m_chunkBumpEnd - m_chunkBumpPointer) < size) {
+            if (!tryAllocateChunk(lock))
+                return nullptr;
+        }
+
+        begin = m_chunkBumpPointer;
+        m_chunkBumpPointer += size;
+
+        ChunkHeader* chunk = reinterpret_cast<ChunkHeader*>(mask(begin, chunkMask));
+        size_t firstPage = (begin - reinterpret_cast<char*>(chunk)) / smallPageSize;
+        for (size_t i = 0; i < pageCount; ++i)
+            chunk->firstPages[firstPage + i] = firstPage;
+
+        run = &chunk->runs[firstPage];
+        run->pageCount = pageCount;
+    }
+
+    run->sizeClass = sizeClass;
+    BASSERT(!run->objectCount);
+
+    // Thread the whole run onto its free list, lowest address first.
+    size_t objectSize = bmalloc::objectSize(sizeClass);
+    FreeObject* freeList = nullptr;
+    for (size_t i = size / objectSize; i--;) {
+        FreeObject* object = reinterpret_cast<FreeObject*>(begin + i * objectSize);
+        object->next = freeList;
+        freeList = object;
+    }
+    run->freeList = freeList;
+
+    m_runsWithFreeObjects[sizeClass].push(run);
+    return run;
+}
+
+inline void* IsolatedHeap::tryAllocateSmall(std::lock_guard<StaticMutex>& lock, size_t sizeClass)
+{
+    List<Run>& runs = m_runsWithFreeObjects[sizeClass];
+    Run* run = runs.isEmpty() ? tryAllocateRun(lock, sizeClass) : runs.head();
+    if (!run)
+        return nullptr;
+
+    FreeObject* object = run->freeList;
+    run->freeList = object->next;
+    ++run->objectCount;
+    if (!run->freeList)
+        runs.remove(run);
+    return object;
+}
+
+inline void* IsolatedHeap::tryAllocateLarge(std::lock_guard<StaticMutex>&, size_t size)
+{
+    size_t vmSize = bmalloc::vmSize(size);
+    void* result = tryVMAllocate(chunkSize, vmSize);
+    if (!result)
+        return nullptr;
+
+    m_largeObjects.set(result, vmSize);
+    m_largeObjectBytes += vmSize;
+    return result;
+}
+
+inline void* IsolatedHeap::tryAllocate(size_t size)
+{
+    std::lock_guard<StaticMutex> lock(m_mutex);
+    if (size <= smallMax)
+        return tryAllocateSmall(lock, bmalloc::sizeClass(size));
+    return tryAllocateLarge(lock, size);
+}
+
+inline void* IsolatedHeap::allocate(size_t size)
+{
+    void* result = tryAllocate(size);
+    RELEASE_BASSERT(result);
+    return result;
+}
+
+inline void IsolatedHeap::deallocateSmall(std::lock_guard<StaticMutex>&, void* object)
+{
+    ChunkHeader* chunk = static_cast<ChunkHeader*>(mask(object, chunkMask));
+    RELEASE_BASSERT(chunk->owner == this);
+
+    size_t page = (static_cast<char*>(object) - reinterpret_cast<char*>(chunk)) / smallPageSize;
+    Run* run = &chunk->runs[chunk->firstPages[page]];
+    List<Run>& runs = m_runsWithFreeObjects[run->sizeClass];
+
+    FreeObject* freeObject = static_cast<FreeObject*>(object);
+    if (!run->freeList)
+        runs.push(run);
+    freeObject->next = run->freeList;
+    run->freeList = freeObject;
+
+    BASSERT(run->objectCount);
+    if (--run->objectCount)
+        return;
+
+    // Keep the last run with free objects committed, so that a size class
+    // that allocates and frees one object at a time doesn't fault every time.
+    if (runs.head() == run && runs.tail() == run)
+        return;
+
+    runs.remove(run);
+    run->freeList = nullptr;
+    vmDeallocatePhysicalPagesSloppy(runBegin(run), run->pageCount * smallPageSize);
+    m_freeRuns[run->pageCount].push(run);
+}
+
+inline void IsolatedHeap::deallocate(void* object)
+{
+    if (!object)
+        return;
+
+    std::lock_guard<StaticMutex> lock(m_mutex);
+
+    if (test(object, ~chunkMask))
+        return deallocateSmall(lock, object);
+
+    size_t vmSize = m_largeObjects.remove(object);
+    m_largeObjectBytes -= vmSize;
+    vmDeallocate(object, vmSize);
+}
+
+} // namespace bmalloc
+
+#endif // IsolatedHeap_h
@@ -26,6 +26,9 @@
 #ifndef List_h
 #define List_h
 
+#include <cstddef>
+#include <type_traits>
+
 namespace bmalloc {
 
 template<typename T>
@@ -49,6 +52,20 @@ public:
     T* head() { return static_cast<T*>(m_root.next); }
     T* tail() { return static_cast<T*>(m_root.prev); }
 
+    // O(n). Intended for statistics and rare bookkeeping, not hot paths.
+    template<typename Function> void forEach(const Function& function)
+    {
+        for (ListNode<T>* it = m_root.next; it != &m_root; it = it->next)
+            function(static_cast<T*>(it));
+    }
+
+    size_t count()
+    {
+        size_t count = 0;
+        forEach([&](T*) { ++count; });
+        return count;
+    }
+
     void push(T* node)
     {
         ListNode<T>* it = tail();
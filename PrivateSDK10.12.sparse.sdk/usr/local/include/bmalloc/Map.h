@@ -79,6 +79,14 @@ public:
         return value;
     }
 
+    template<typename Function> void forEach(const Function& function)
+    {
+        for (auto& bucket : m_table) {
+            if (bucket.key)
+                function(bucket.key, bucket.value);
+        }
+    }
+
 private:
     static const unsigned minCapacity = 16;
     static const unsigned maxLoad = 2;
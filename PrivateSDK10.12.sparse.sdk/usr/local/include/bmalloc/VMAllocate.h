@@ -181,6 +181,29 @@ inline void* vmAllocate(size_t vmAlignment, size_t vmSize)
     return result;
 }
 
+// Transparent huge pages are a Linux feature. Chunks are already chunkSize
+// aligned, which matches the 2MB huge page size on x86_64 and arm64.
+inline bool vmHugePagesAreAvailable()
+{
+#if BOS(LINUX) && defined(MADV_HUGEPAGE)
+    return chunkSize == 2 * MB;
+#else
+    return false;
+#endif
+}
+
+inline void vmAllocateHugePages(void* p, size_t vmSize)
+{
+    vmValidate(p, vmSize);
+#if BOS(LINUX) && defined(MADV_HUGEPAGE)
+    BASSERT(p == mask(p, chunkMask));
+    SYSCALL(madvise(p, vmSize, MADV_HUGEPAGE));
+#else
+    UNUSED(p);
+    UNUSED(vmSize);
+#endif
+}
+
 inline void vmDeallocatePhysicalPages(void* p, size_t vmSize)
 {
     vmValidatePhysical(p, vmSize);
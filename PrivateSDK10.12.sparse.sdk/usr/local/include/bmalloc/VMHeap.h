@@ -27,6 +27,7 @@
 #define VMHeap_h
 
 #include "Chunk.h"
+#include "Environment.h"
 #include "FixedVector.h"
 #include "Map.h"
 #include "Vector.h"
@@ -47,9 +48,13 @@ public:
     void deallocateSmallPage(std::unique_lock<StaticMutex>&, size_t, SmallPage*);
 
     XLargeRange tryAllocateLargeChunk(std::lock_guard<StaticMutex>&, size_t alignment, size_t);
+
+    // O(n), for statistics.
+    size_t smallPageCount(std::lock_guard<StaticMutex>&, size_t pageClass) { return m_smallPages[pageClass].count(); }
     
 private:
     void allocateSmallChunk(std::lock_guard<StaticMutex>&, size_t);
+    void allocateHugePageSmallChunk(std::lock_guard<StaticMutex>&, size_t);
 
     std::array<List<SmallPage>, pageClassCount> m_smallPages;
     
@@ -58,12 +63,50 @@ private:
 #endif
 };
 
+// Mirrors allocateSmallChunk() without the guard pages, which would split the
+// huge page mapping for good.
+inline void VMHeap::allocateHugePageSmallChunk(std::lock_guard<StaticMutex>& lock, size_t pageClass)
+{
+    size_t pageSize = bmalloc::pageSize(pageClass);
+    size_t smallPageCount = pageSize / smallPageSize;
+
+    void* memory = vmAllocate(chunkSize, chunkSize);
+    Chunk* chunk = static_cast<Chunk*>(memory);
+    vmAllocateHugePages(chunk, chunkSize);
+
+    size_t vmPageSize = roundUpToMultipleOf(bmalloc::vmPageSize(), pageSize);
+    size_t metadataSize = roundUpToMultipleOfNonPowerOfTwo(vmPageSize, sizeof(Chunk));
+
+    Object begin(chunk, metadataSize);
+    Object end(chunk, chunkSize);
+
+    new (chunk) Chunk(lock);
+
+#if BOS(DARWIN)
+    m_zone.addRange(Range(chunk->bytes(), chunkSize));
+#endif
+
+    for (Object it = begin; it + pageSize <= end; it = it + pageSize) {
+        SmallPage* page = it.page();
+        for (size_t i = 0; i < smallPageCount; ++i)
+            page[i].setSlide(i);
+        m_smallPages[pageClass].push(page);
+    }
+}
+
 inline SmallPage* VMHeap::allocateSmallPage(std::lock_guard<StaticMutex>& lock, size_t pageClass)
 {
-    if (m_smallPages[pageClass].isEmpty())
-        allocateSmallChunk(lock, pageClass);
+    List<SmallPage>& smallPages = m_smallPages[pageClass];
+    if (smallPages.isEmpty()) {
+        // A chunk is exactly one 2MB huge page, so it stays a single TLB
+        // entry until the scavenger decommits one of its pages.
+        if (Environment::isHugePageChunksEnabled() && vmHugePagesAreAvailable())
+            allocateHugePageSmallChunk(lock, pageClass);
+        else
+            allocateSmallChunk(lock, pageClass);
+    }
 
-    SmallPage* page = m_smallPages[pageClass].pop();
+    SmallPage* page = smallPages.pop();
     vmAllocatePhysicalPagesSloppy(page->begin()->begin(), pageSize(pageClass));
     return page;
 }
@@ -25,6 +25,8 @@
 
 #include "Cache.h"
 #include "Heap.h"
+#include "HeapStatistics.h"
+#include "IsolatedHeap.h"
 #include "PerProcess.h"
 #include "StaticMutex.h"
 
@@ -60,6 +62,26 @@ inline void free(void* object)
     Cache::deallocate(object);
 }
 
+// size must be the size most recently passed to malloc, tryMalloc or realloc
+// for object. Not for use with memalign, whose alignment can make a small
+// size into a large object.
+inline void freeSized(void* object, size_t size)
+{
+    Cache::deallocateSized(object, size);
+}
+
+// Allocates count objects of the same size into objects. Much cheaper per
+// object than calling malloc in a loop. Crashes on failure.
+inline void mallocBatch(size_t size, size_t count, void** objects)
+{
+    Cache::allocateBatch(size, count, objects);
+}
+
+inline void freeBatch(void* const* objects, size_t count)
+{
+    Cache::deallocateBatch(objects, count);
+}
+
 inline void scavengeThisThread()
 {
     Cache::scavenge();
@@ -69,9 +91,55 @@ inline void scavenge()
 {
     scavengeThisThread();
 
+    {
+        std::lock_guard<StaticMutex> lock(PerProcess<Heap>::mutex());
+        PerProcess<Heap>::get()->processDeferredFrees(lock);
+    }
+
     std::unique_lock<StaticMutex> lock(PerProcess<Heap>::mutex());
     PerProcess<Heap>::get()->scavenge(lock, std::chrono::milliseconds(0));
 }
 
+// Creates a heap that shares no memory with malloc or with other isolated
+// heaps. name must outlive the heap.
+inline IsolatedHeap* createHeap(const char* name)
+{
+    return IsolatedHeap::create(name);
+}
+
+// Releases every object still allocated from heap, in O(chunks).
+inline void destroyHeap(IsolatedHeap* heap)
+{
+    IsolatedHeap::destroy(heap);
+}
+
+// Returns null on failure.
+inline void* tryMalloc(IsolatedHeap* heap, size_t size)
+{
+    return heap->tryAllocate(size);
+}
+
+// Crashes on failure.
+inline void* malloc(IsolatedHeap* heap, size_t size)
+{
+    return heap->allocate(size);
+}
+
+// object must have been allocated from heap.
+inline void free(IsolatedHeap* heap, void* object)
+{
+    heap->deallocate(object);
+}
+
+// Cheap enough to poll about once a second from a monitoring thread. Holds the
+// heap lock while it walks the free lists, which briefly stalls refills.
+inline HeapStatistics stats()
+{
+    HeapStatistics statistics;
+    std::lock_guard<StaticMutex> lock(PerProcess<Heap>::mutex());
+    PerProcess<Heap>::get()->collectStatistics(lock, statistics);
+    return statistics;
+}
+
 } // namespace api
 } // namespace bmalloc
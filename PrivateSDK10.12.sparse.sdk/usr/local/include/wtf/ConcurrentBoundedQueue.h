@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <wtf/Assertions.h>
+#include <wtf/FastMalloc.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Optional.h>
+#include <wtf/ParkingLot.h>
+#include <wtf/StdLibExtras.h>
+
+namespace WTF {
+
+enum class ConcurrentQueueMode {
+    SingleProducerSingleConsumer,
+    MultiProducerMultiConsumer
+};
+
+// A fixed-capacity ring buffer queue that passes messages between threads without taking a lock.
+// Every slot carries a sequence number that says whether it is free or holds a message for the
+// current lap, so producers and consumers only ever contend on their own end of the ring. In
+// MultiProducerMultiConsumer mode each end is claimed with a compare-and-swap; in
+// SingleProducerSingleConsumer mode there is one thread per end and a plain store will do.
+//
+// The try* functions never block. append() and waitForMessage() spin briefly and then park on the
+// ParkingLot, but only while the queue is full or empty respectively. The batch functions move as
+// many messages as they can in one claim, and wake every parked thread on the other end.
+template<typename DataType, ConcurrentQueueMode mode = ConcurrentQueueMode::MultiProducerMultiConsumer>
+class ConcurrentBoundedQueue {
+    WTF_MAKE_NONCOPYABLE(ConcurrentBoundedQueue);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    // The capacity is rounded up to a power of two.
+    explicit ConcurrentBoundedQueue(size_t capacity);
+    ~ConcurrentBoundedQueue();
+
+    size_t capacity() const { return m_mask + 1; }
+
+    bool tryAppend(DataType&&);
+    void append(DataType&&);
+
+    // Moves up to count messages out of the array, stopping early if the queue fills up. Returns
+    // the number appended.
+    size_t tryAppend(DataType* messages, size_t count);
+
+    Optional<DataType> tryGetMessage();
+    DataType waitForMessage();
+
+    // Moves up to maxCount messages into the array. Returns the number taken; waitForMessages()
+    // blocks until that is at least one.
+    size_t tryGetMessages(DataType* messages, size_t maxCount);
+    size_t waitForMessages(DataType* messages, size_t maxCount);
+
+private:
+    static const unsigned spinLimit = 40;
+    static const size_t cacheLineSize = 64;
+
+    // A slot is free for the producer at position p when its sequence is p, and holds the
+    // message for the consumer at position p when its sequence is p + 1.
+    static const size_t producerOffset = 0;
+    static const size_t consumerOffset = 1;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(DataType), alignof(DataType)>::type storage;
+
+        DataType& data() { return *reinterpret_cast<DataType*>(&storage); }
+    };
+
+    // Keeps each end of the ring on its own cache line.
+    struct PaddedPosition {
+        std::atomic<size_t> value { 0 };
+        char padding[cacheLineSize - sizeof(std::atomic<size_t>)];
+    };
+
+    size_t claim(PaddedPosition&, size_t sequenceOffset, size_t maxCount, size_t& start);
+    bool isReady(const PaddedPosition&, size_t sequenceOffset) const;
+    void notify(std::atomic<unsigned>& waiters, size_t count);
+    void wait(std::atomic<unsigned>& waiters, const PaddedPosition&, size_t sequenceOffset);
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    char m_padding[cacheLineSize];
+    PaddedPosition m_appendPosition;
+    PaddedPosition m_takePosition;
+    std::atomic<unsigned> m_waitingProducers { 0 };
+    std::atomic<unsigned> m_waitingConsumers { 0 };
+};
+
+template<typename DataType, ConcurrentQueueMode mode>
+ConcurrentBoundedQueue<DataType, mode>::ConcurrentBoundedQueue(size_t capacity)
+{
+    size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity)
+        roundedCapacity <<= 1;
+    m_cells = std::make_unique<Cell[]>(roundedCapacity);
+    m_mask = roundedCapacity - 1;
+    for (size_t i = 0; i < roundedCapacity; ++i)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+ConcurrentBoundedQueue<DataType, mode>::~ConcurrentBoundedQueue()
+{
+    size_t end = m_appendPosition.value.load(std::memory_order_relaxed);
+    for (size_t position = m_takePosition.value.load(std::memory_order_relaxed); position < end; ++position)
+        m_cells[position & m_mask].data().~DataType();
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+size_t ConcurrentBoundedQueue<DataType, mode>::claim(PaddedPosition& position, size_t sequenceOffset, size_t maxCount, size_t& start)
+{
+    size_t current = position.value.load(std::memory_order_relaxed);
+    for (;;) {
+        size_t count = 0;
+        while (count < maxCount && m_cells[(current + count) & m_mask].sequence.load(std::memory_order_acquire) == current + count + sequenceOffset)
+            ++count;
+
+        if (!count) {
+            // Either the ring is full (or empty), or another thread claimed this position first.
+            size_t latest = position.value.load(std::memory_order_relaxed);
+            if (latest == current)
+                return 0;
+            current = latest;
+            continue;
+        }
+
+        if (mode == ConcurrentQueueMode::SingleProducerSingleConsumer) {
+            position.value.store(current + count, std::memory_order_relaxed);
+            start = current;
+            return count;
+        }
+
+        if (position.value.compare_exchange_weak(current, current + count, std::memory_order_relaxed)) {
+            start = current;
+            return count;
+        }
+    }
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+bool ConcurrentBoundedQueue<DataType, mode>::isReady(const PaddedPosition& position, size_t sequenceOffset) const
+{
+    size_t current = position.value.load(std::memory_order_relaxed);
+    return m_cells[current & m_mask].sequence.load(std::memory_order_acquire) == current + sequenceOffset;
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+void ConcurrentBoundedQueue<DataType, mode>::notify(std::atomic<unsigned>& waiters, size_t count)
+{
+    // Pairs with the fence in wait(): either the waiter sees our update, or we see the waiter.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!waiters.load(std::memory_order_relaxed))
+        return;
+    if (count == 1)
+        ParkingLot::unparkOne(&waiters);
+    else
+        ParkingLot::unparkAll(&waiters);
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+void ConcurrentBoundedQueue<DataType, mode>::wait(std::atomic<unsigned>& waiters, const PaddedPosition& position, size_t sequenceOffset)
+{
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    ParkingLot::parkConditionally(
+        &waiters,
+        [&] () -> bool {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return !isReady(position, sequenceOffset);
+        },
+        [] () { },
+        ParkingLot::Clock::time_point::max());
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+bool ConcurrentBoundedQueue<DataType, mode>::tryAppend(DataType&& message)
+{
+    return tryAppend(&message, 1);
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+void ConcurrentBoundedQueue<DataType, mode>::append(DataType&& message)
+{
+    for (unsigned i = 0; ; ++i) {
+        if (tryAppend(&message, 1))
+            return;
+        if (i < spinLimit)
+            std::this_thread::yield();
+        else
+            wait(m_waitingProducers, m_appendPosition, producerOffset);
+    }
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+size_t ConcurrentBoundedQueue<DataType, mode>::tryAppend(DataType* messages, size_t count)
+{
+    size_t start;
+    size_t claimed = claim(m_appendPosition, producerOffset, count, start);
+    for (size_t i = 0; i < claimed; ++i) {
+        Cell& cell = m_cells[(start + i) & m_mask];
+        new (NotNull, &cell.storage) DataType(WTFMove(messages[i]));
+        cell.sequence.store(start + i + consumerOffset, std::memory_order_release);
+    }
+    if (claimed)
+        notify(m_waitingConsumers, claimed);
+    return claimed;
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+Optional<DataType> ConcurrentBoundedQueue<DataType, mode>::tryGetMessage()
+{
+    size_t start;
+    if (!claim(m_takePosition, consumerOffset, 1, start))
+        return { };
+
+    Cell& cell = m_cells[start & m_mask];
+    Optional<DataType> result(WTFMove(cell.data()));
+    cell.data().~DataType();
+    cell.sequence.store(start + capacity(), std::memory_order_release);
+    notify(m_waitingProducers, 1);
+    return result;
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+DataType ConcurrentBoundedQueue<DataType, mode>::waitForMessage()
+{
+    for (unsigned i = 0; ; ++i) {
+        if (Optional<DataType> message = tryGetMessage())
+            return WTFMove(message.value());
+        if (i < spinLimit)
+            std::this_thread::yield();
+        else
+            wait(m_waitingConsumers, m_takePosition, consumerOffset);
+    }
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+size_t ConcurrentBoundedQueue<DataType, mode>::tryGetMessages(DataType* messages, size_t maxCount)
+{
+    size_t start;
+    size_t claimed = claim(m_takePosition, consumerOffset, maxCount, start);
+    for (size_t i = 0; i < claimed; ++i) {
+        Cell& cell = m_cells[(start + i) & m_mask];
+        messages[i] = WTFMove(cell.data());
+        cell.data().~DataType();
+        cell.sequence.store(start + i + capacity(), std::memory_order_release);
+    }
+    if (claimed)
+        notify(m_waitingProducers, claimed);
+    return claimed;
+}
+
+template<typename DataType, ConcurrentQueueMode mode>
+size_t ConcurrentBoundedQueue<DataType, mode>::waitForMessages(DataType* messages, size_t maxCount)
+{
+    ASSERT(maxCount);
+    for (unsigned i = 0; ; ++i) {
+        if (size_t taken = tryGetMessages(messages, maxCount))
+            return taken;
+        if (i < spinLimit)
+            std::this_thread::yield();
+        else
+            wait(m_waitingConsumers, m_takePosition, consumerOffset);
+    }
+}
+
+} // namespace WTF
+
+using WTF::ConcurrentBoundedQueue;
+using WTF::ConcurrentQueueMode;
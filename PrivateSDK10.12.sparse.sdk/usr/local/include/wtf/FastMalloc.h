@@ -49,6 +49,11 @@ WTF_EXPORT_PRIVATE TryMallocReturnValue tryFastMalloc(size_t);
 TryMallocReturnValue tryFastZeroedMalloc(size_t);
 WTF_EXPORT_PRIVATE TryMallocReturnValue tryFastCalloc(size_t numElements, size_t elementSize);
 
+// FIXME: Add a sized fastFree() that forwards to bmalloc::api::freeSized(). It
+// can't be an inline function here: bmalloc's slow paths and its PerProcess
+// and PerThread state are internal to JavaScriptCore, so WTF clients outside it
+// would fail to link or get a heap of their own. It needs an exported
+// out-of-line definition in FastMalloc.cpp, next to fastFree().
 WTF_EXPORT_PRIVATE void fastFree(void*);
 
 // Allocations from fastAlignedMalloc() must be freed using fastAlignedFree().
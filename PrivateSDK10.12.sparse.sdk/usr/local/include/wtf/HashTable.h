@@ -36,6 +36,10 @@
 #include <wtf/StdLibExtras.h>
 #include <wtf/ValueCheck.h>
 
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define DUMP_HASHTABLE_STATS 0
 #define DUMP_HASHTABLE_STATS_PER_TABLE 0
 
@@ -103,8 +107,45 @@ namespace WTF {
 
     typedef enum { HashItemKnownGood } HashItemKnownGoodTag;
 
+    // While a table with incremental rehashing is moving its buckets, an iterator walks the remaining
+    // buckets of the previous table first and then continues with the buckets of the current table.
+    template<typename PointerType, bool usesIncrementalRehash> struct HashTableIteratorNextRange {
+        HashTableIteratorNextRange() { }
+        HashTableIteratorNextRange(PointerType, PointerType) { ASSERT_NOT_REACHED(); }
+        bool takeNextRange(PointerType&, PointerType&) { return false; }
+    };
+
+    template<typename PointerType> struct HashTableIteratorNextRange<PointerType, true> {
+        HashTableIteratorNextRange()
+            : m_nextPosition(nullptr)
+            , m_nextEndPosition(nullptr)
+        {
+        }
+
+        HashTableIteratorNextRange(PointerType position, PointerType endPosition)
+            : m_nextPosition(position)
+            , m_nextEndPosition(endPosition)
+        {
+        }
+
+        bool takeNextRange(PointerType& position, PointerType& endPosition)
+        {
+            if (!m_nextPosition)
+                return false;
+            position = m_nextPosition;
+            endPosition = m_nextEndPosition;
+            m_nextPosition = nullptr;
+            m_nextEndPosition = nullptr;
+            return true;
+        }
+
+        PointerType m_nextPosition;
+        PointerType m_nextEndPosition;
+    };
+
     template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
-    class HashTableConstIterator : public std::iterator<std::forward_iterator_tag, Value, std::ptrdiff_t, const Value*, const Value&> {
+    class HashTableConstIterator : public std::iterator<std::forward_iterator_tag, Value, std::ptrdiff_t, const Value*, const Value&>
+        , private HashTableIteratorNextRange<const Value*, KeyTraits::usesIncrementalRehash> {
     private:
         typedef HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits> HashTableType;
         typedef HashTableIterator<Key, Value, Extractor, HashFunctions, Traits, KeyTraits> iterator;
@@ -112,25 +153,30 @@ namespace WTF {
         typedef Value ValueType;
         typedef const ValueType& ReferenceType;
         typedef const ValueType* PointerType;
+        typedef HashTableIteratorNextRange<const Value*, KeyTraits::usesIncrementalRehash> NextRange;
 
         friend class HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>;
         friend class HashTableIterator<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>;
 
         void skipEmptyBuckets()
         {
-            while (m_position != m_endPosition && HashTableType::isEmptyOrDeletedBucket(*m_position))
-                ++m_position;
+            while (true) {
+                while (m_position != m_endPosition && HashTableType::isEmptyOrDeletedBucket(*m_position))
+                    ++m_position;
+                if (m_position != m_endPosition || !this->takeNextRange(m_position, m_endPosition))
+                    return;
+            }
         }
 
-        HashTableConstIterator(const HashTableType* table, PointerType position, PointerType endPosition)
-            : m_position(position), m_endPosition(endPosition)
+        HashTableConstIterator(const HashTableType* table, PointerType position, PointerType endPosition, const NextRange& nextRange = NextRange())
+            : NextRange(nextRange), m_position(position), m_endPosition(endPosition)
         {
             addIterator(table, this);
             skipEmptyBuckets();
         }
 
-        HashTableConstIterator(const HashTableType* table, PointerType position, PointerType endPosition, HashItemKnownGoodTag)
-            : m_position(position), m_endPosition(endPosition)
+        HashTableConstIterator(const HashTableType* table, PointerType position, PointerType endPosition, HashItemKnownGoodTag, const NextRange& nextRange = NextRange())
+            : NextRange(nextRange), m_position(position), m_endPosition(endPosition)
         {
             addIterator(table, this);
         }
@@ -150,13 +196,14 @@ namespace WTF {
         }
 
         HashTableConstIterator(const const_iterator& other)
-            : m_position(other.m_position), m_endPosition(other.m_endPosition)
+            : NextRange(other), m_position(other.m_position), m_endPosition(other.m_endPosition)
         {
             addIterator(other.m_table, this);
         }
 
         const_iterator& operator=(const const_iterator& other)
         {
+            NextRange::operator=(other);
             m_position = other.m_position;
             m_endPosition = other.m_endPosition;
 
@@ -248,11 +295,12 @@ namespace WTF {
         typedef Value ValueType;
         typedef ValueType& ReferenceType;
         typedef ValueType* PointerType;
+        typedef typename const_iterator::NextRange NextRange;
 
         friend class HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>;
 
-        HashTableIterator(HashTableType* table, PointerType pos, PointerType end) : m_iterator(table, pos, end) { }
-        HashTableIterator(HashTableType* table, PointerType pos, PointerType end, HashItemKnownGoodTag tag) : m_iterator(table, pos, end, tag) { }
+        HashTableIterator(HashTableType* table, PointerType pos, PointerType end, const NextRange& nextRange = NextRange()) : m_iterator(table, pos, end, nextRange) { }
+        HashTableIterator(HashTableType* table, PointerType pos, PointerType end, HashItemKnownGoodTag tag, const NextRange& nextRange = NextRange()) : m_iterator(table, pos, end, tag, nextRange) { }
 
     public:
         HashTableIterator() { }
@@ -298,8 +346,128 @@ namespace WTF {
         explicit operator bool() const { return isNewEntry; }
     };
 
+    // Control bytes used by tables whose KeyTraits set usesControlBytes. Each bucket has one byte:
+    // either a marker, which has the high bit set, or the low 7 bits of the hash of its key.
+    // The remaining hash bits select the first group of buckets to probe.
+    static const uint8_t hashTableControlEmpty = 0x80;
+    static const uint8_t hashTableControlDeleted = 0xFE;
+    static const unsigned hashTableControlGroupSize = 16;
+
+    inline uint8_t hashTableControlHash(unsigned hash) { return hash & 0x7F; }
+    inline unsigned hashTableControlGroupHash(unsigned hash) { return hash >> 7; }
+
+    class HashTableControlGroup {
+    public:
+        explicit HashTableControlGroup(const uint8_t* controlBytes)
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+            : m_bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(controlBytes)))
+        {
+        }
+#else
+        {
+            memcpy(m_bytes, controlBytes, hashTableControlGroupSize);
+        }
+#endif
+
+        // These return one bit per bucket of the group, bucket 0 in the lowest bit.
+        unsigned match(uint8_t controlHash) const
+        {
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(m_bytes, _mm_set1_epi8(controlHash)));
+#else
+            unsigned result = 0;
+            for (unsigned i = 0; i < hashTableControlGroupSize; ++i)
+                result |= static_cast<unsigned>(m_bytes[i] == controlHash) << i;
+            return result;
+#endif
+        }
+
+        unsigned matchEmpty() const { return match(hashTableControlEmpty); }
+
+        unsigned matchEmptyOrDeleted() const
+        {
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+            return _mm_movemask_epi8(m_bytes);
+#else
+            unsigned result = 0;
+            for (unsigned i = 0; i < hashTableControlGroupSize; ++i)
+                result |= static_cast<unsigned>(m_bytes[i] >> 7) << i;
+            return result;
+#endif
+        }
+
+        static unsigned firstIndex(unsigned mask)
+        {
+            ASSERT(mask);
+#if COMPILER(GCC_OR_CLANG)
+            return __builtin_ctz(mask);
+#else
+            unsigned index = 0;
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++index;
+            }
+            return index;
+#endif
+        }
+
+    private:
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+        __m128i m_bytes;
+#else
+        uint8_t m_bytes[hashTableControlGroupSize];
+#endif
+    };
+
+    // The table that buckets are being moved out of while a table with incremental rehashing grows or shrinks.
+    // Buckets below the migration index have already been moved. Tables that do not opt in pay nothing for it.
+    template<typename Value, bool usesIncrementalRehash> class HashTableOldTable {
+    public:
+        Value* oldTable() const { return nullptr; }
+        unsigned oldTableSize() const { return 0; }
+        unsigned oldTableMigrationIndex() const { return 0; }
+        void setOldTable(Value*, unsigned) { ASSERT_NOT_REACHED(); }
+        void setOldTableMigrationIndex(unsigned) { ASSERT_NOT_REACHED(); }
+        void swapOldTable(HashTableOldTable&) { }
+    };
+
+    template<typename Value> class HashTableOldTable<Value, true> {
+    public:
+        HashTableOldTable()
+            : m_oldTable(nullptr)
+            , m_oldTableSize(0)
+            , m_oldTableMigrationIndex(0)
+        {
+        }
+
+        Value* oldTable() const { return m_oldTable; }
+        unsigned oldTableSize() const { return m_oldTableSize; }
+        unsigned oldTableMigrationIndex() const { return m_oldTableMigrationIndex; }
+
+        void setOldTable(Value* table, unsigned size)
+        {
+            m_oldTable = table;
+            m_oldTableSize = size;
+            m_oldTableMigrationIndex = 0;
+        }
+
+        void setOldTableMigrationIndex(unsigned index) { m_oldTableMigrationIndex = index; }
+
+        void swapOldTable(HashTableOldTable& other)
+        {
+            std::swap(m_oldTable, other.m_oldTable);
+            std::swap(m_oldTableSize, other.m_oldTableSize);
+            std::swap(m_oldTableMigrationIndex, other.m_oldTableMigrationIndex);
+        }
+
+    private:
+        Value* m_oldTable;
+        unsigned m_oldTableSize;
+        unsigned m_oldTableMigrationIndex;
+    };
+
     template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
-    class HashTable {
+    class HashTable : private HashTableOldTable<Value, KeyTraits::usesIncrementalRehash> {
     public:
         typedef HashTableIterator<Key, Value, Extractor, HashFunctions, Traits, KeyTraits> iterator;
         typedef HashTableConstIterator<Key, Value, Extractor, HashFunctions, Traits, KeyTraits> const_iterator;
@@ -316,6 +484,8 @@ namespace WTF {
                 , numRehashes(0)
                 , numRemoves(0)
                 , numReinserts(0)
+                , numMigratedBuckets(0)
+                , numOldTableLookups(0)
                 , maxCollisions(0)
                 , numCollisions(0)
                 , collisionGraph()
@@ -326,6 +496,8 @@ namespace WTF {
             unsigned numRehashes;
             unsigned numRemoves;
             unsigned numReinserts;
+            unsigned numMigratedBuckets;
+            unsigned numOldTableLookups;
 
             unsigned maxCollisions;
             unsigned numCollisions;
@@ -350,6 +522,8 @@ namespace WTF {
                 }
                 dataLogF("%d rehashes\n", numRehashes);
                 dataLogF("%d reinserts\n", numReinserts);
+                dataLogF("%d buckets migrated incrementally\n", numMigratedBuckets);
+                dataLogF("%d lookups fell back to the old table\n", numOldTableLookups);
             }
         };
 #endif
@@ -360,6 +534,8 @@ namespace WTF {
             invalidateIterators(); 
             if (m_table)
                 deallocateTable(m_table, m_tableSize);
+            if (this->oldTable())
+                deallocateTable(this->oldTable(), this->oldTableSize());
 #if CHECK_HASHTABLE_USE_AFTER_DESTRUCTION
             m_table = (ValueType*)(uintptr_t)0xbbadbeef;
 #endif
@@ -375,9 +551,9 @@ namespace WTF {
         // When the hash table is empty, just return the same iterator for end as for begin.
         // This is more efficient because we don't have to skip all the empty and deleted
         // buckets, and iterating an empty table is a common case that's worth optimizing.
-        iterator begin() { return isEmpty() ? end() : makeIterator(m_table); }
+        iterator begin() { return isEmpty() ? end() : makeIterator(firstBucket()); }
         iterator end() { return makeKnownGoodIterator(m_table + m_tableSize); }
-        const_iterator begin() const { return isEmpty() ? end() : makeConstIterator(m_table); }
+        const_iterator begin() const { return isEmpty() ? end() : makeConstIterator(firstBucket()); }
         const_iterator end() const { return makeKnownGoodConstIterator(m_table + m_tableSize); }
 
         unsigned size() const { return m_keyCount; }
@@ -431,6 +607,9 @@ namespace WTF {
 #endif
 
     private:
+        typedef HashTableOldTable<Value, KeyTraits::usesIncrementalRehash> OldTable;
+        typedef typename const_iterator::NextRange IteratorNextRange;
+
         static ValueType* allocateTable(unsigned size);
         static void deallocateTable(ValueType* table, unsigned size);
 
@@ -443,31 +622,72 @@ namespace WTF {
 
         template<typename HashTranslator, typename T, typename Extra> void addUniqueForInitialization(T&& key, Extra&&);
 
+        static uint8_t* controlBytes(ValueType* table, unsigned tableSize) { return reinterpret_cast<uint8_t*>(table + tableSize); }
+        uint8_t* controlBytes() const { return controlBytes(m_table, m_tableSize); }
+        void setControlByte(ValueType* entry, uint8_t value) { controlBytes()[entry - m_table] = value; }
+        template<typename HashTranslator, typename T> ValueType* lookupWithControlBytes(ValueType* table, unsigned tableSize, const T&, unsigned hash);
+        template<typename HashTranslator, typename T> LookupType lookupForWritingWithControlBytes(const T&, unsigned hash);
+        ValueType* insertionBucketWithControlBytes(unsigned hash);
+
         template<typename HashTranslator, typename T> void checkKey(const T&);
 
         void removeAndInvalidateWithoutEntryConsistencyCheck(ValueType*);
         void removeAndInvalidate(ValueType*);
         void remove(ValueType*);
 
-        bool shouldExpand() const { return (m_keyCount + m_deletedCount) * m_maxLoad >= m_tableSize; }
+        bool shouldExpand() const
+        {
+            if (KeyTraits::usesControlBytes)
+                return (m_keyCount + m_deletedCount) * m_maxLoadWithControlBytesDenominator >= m_tableSize * m_maxLoadWithControlBytesNumerator;
+            return (m_keyCount + m_deletedCount) * m_maxLoad >= m_tableSize;
+        }
         bool mustRehashInPlace() const { return m_keyCount * m_minLoad < m_tableSize * 2; }
-        bool shouldShrink() const { return m_keyCount * m_minLoad < m_tableSize && m_tableSize > KeyTraits::minimumTableSize; }
+        bool shouldShrink() const { return m_keyCount * m_minLoad < m_tableSize && m_tableSize > m_minimumTableSize; }
         ValueType* expand(ValueType* entry = nullptr);
         void shrink() { rehash(m_tableSize / 2, nullptr); }
 
         ValueType* rehash(unsigned newTableSize, ValueType* entry);
         ValueType* reinsert(ValueType&&);
 
+        bool isInOldTable(const ValueType* entry) const { return this->oldTable() && entry >= this->oldTable() && entry < this->oldTable() + this->oldTableSize(); }
+        ValueType* firstBucket() const { return this->oldTable() ? this->oldTable() + this->oldTableMigrationIndex() : m_table; }
+        template<typename HashTranslator, typename T> ValueType* lookupInTable(ValueType* table, unsigned tableSize, const T&, unsigned hash);
+        template<typename HashTranslator, typename T> ValueType* lookupInOldTable(const T&, unsigned hash);
+        ValueType* beginIncrementalRehash(unsigned newTableSize, ValueType* entry);
+        void continueIncrementalRehash();
+        void finishIncrementalRehash();
+        ValueType* migrateBucket(ValueType&);
+
         static void initializeBucket(ValueType& bucket);
         static void deleteBucket(ValueType& bucket) { hashTraitsDeleteBucket<Traits>(bucket); }
 
         FullLookupType makeLookupResult(ValueType* position, bool found, unsigned hash)
             { return FullLookupType(LookupType(position, found), hash); }
 
-        iterator makeIterator(ValueType* pos) { return iterator(this, pos, m_table + m_tableSize); }
-        const_iterator makeConstIterator(ValueType* pos) const { return const_iterator(this, pos, m_table + m_tableSize); }
-        iterator makeKnownGoodIterator(ValueType* pos) { return iterator(this, pos, m_table + m_tableSize, HashItemKnownGood); }
-        const_iterator makeKnownGoodConstIterator(ValueType* pos) const { return const_iterator(this, pos, m_table + m_tableSize, HashItemKnownGood); }
+        iterator makeIterator(ValueType* pos)
+        {
+            if (isInOldTable(pos))
+                return iterator(this, pos, this->oldTable() + this->oldTableSize(), IteratorNextRange(m_table, m_table + m_tableSize));
+            return iterator(this, pos, m_table + m_tableSize);
+        }
+        const_iterator makeConstIterator(ValueType* pos) const
+        {
+            if (isInOldTable(pos))
+                return const_iterator(this, pos, this->oldTable() + this->oldTableSize(), IteratorNextRange(m_table, m_table + m_tableSize));
+            return const_iterator(this, pos, m_table + m_tableSize);
+        }
+        iterator makeKnownGoodIterator(ValueType* pos)
+        {
+            if (isInOldTable(pos))
+                return iterator(this, pos, this->oldTable() + this->oldTableSize(), HashItemKnownGood, IteratorNextRange(m_table, m_table + m_tableSize));
+            return iterator(this, pos, m_table + m_tableSize, HashItemKnownGood);
+        }
+        const_iterator makeKnownGoodConstIterator(ValueType* pos) const
+        {
+            if (isInOldTable(pos))
+                return const_iterator(this, pos, this->oldTable() + this->oldTableSize(), HashItemKnownGood, IteratorNextRange(m_table, m_table + m_tableSize));
+            return const_iterator(this, pos, m_table + m_tableSize, HashItemKnownGood);
+        }
 
 #if !ASSERT_DISABLED
         void checkTableConsistencyExceptSize() const;
@@ -484,6 +704,19 @@ namespace WTF {
         static const unsigned m_maxLoad = 2;
         static const unsigned m_minLoad = 6;
 
+        // Tables with control bytes probe whole groups and stop at the first group with an empty
+        // bucket, so they can be filled up to 7/8 and must span at least one group.
+        static const unsigned m_maxLoadWithControlBytesNumerator = 7;
+        static const unsigned m_maxLoadWithControlBytesDenominator = 8;
+        static const unsigned m_minimumTableSize = KeyTraits::usesControlBytes && KeyTraits::minimumTableSize < hashTableControlGroupSize
+            ? hashTableControlGroupSize : KeyTraits::minimumTableSize;
+
+        // Tables with incremental rehashing move this many buckets of the old table on every add or remove.
+        // That is enough to empty the old table well before the new one fills up, whichever way it was resized.
+        // Smaller tables are cheap enough to rehash all at once.
+        static const unsigned m_incrementalRehashStepSize = 32;
+        static const unsigned m_incrementalRehashMinimumTableSize = 4096;
+
         ValueType* m_table;
         unsigned m_tableSize;
         unsigned m_tableSizeMask;
@@ -617,6 +850,15 @@ namespace WTF {
         if (!table)
             return 0;
 
+        if (this->oldTable()) {
+            if (ValueType* entry = lookupInTable<HashTranslator>(table, m_tableSize, key, h))
+                return entry;
+            return lookupInOldTable<HashTranslator>(key, h);
+        }
+
+        if (KeyTraits::usesControlBytes)
+            return lookupWithControlBytes<HashTranslator>(table, m_tableSize, key, h);
+
 #if DUMP_HASHTABLE_STATS
         ++HashTableStats::numAccesses;
         unsigned probeCount = 0;
@@ -671,6 +913,9 @@ namespace WTF {
         unsigned h = HashTranslator::hash(key);
         unsigned i = h & sizeMask;
 
+        if (KeyTraits::usesControlBytes)
+            return lookupForWritingWithControlBytes<HashTranslator>(key, h);
+
 #if DUMP_HASHTABLE_STATS
         ++HashTableStats::numAccesses;
         unsigned probeCount = 0;
@@ -732,6 +977,9 @@ namespace WTF {
         unsigned h = HashTranslator::hash(key);
         unsigned i = h & sizeMask;
 
+        if (KeyTraits::usesControlBytes)
+            return FullLookupType(lookupForWritingWithControlBytes<HashTranslator>(key, h), h);
+
 #if DUMP_HASHTABLE_STATS
         ++HashTableStats::numAccesses;
         unsigned probeCount = 0;
@@ -780,6 +1028,153 @@ namespace WTF {
         }
     }
 
+    // Tables with control bytes probe groups in triangular order: the group visited at step n is
+    // n * (n + 1) / 2 groups away from the first one, which covers every group of a power of two table.
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    template<typename HashTranslator, typename T>
+    ALWAYS_INLINE auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::lookupWithControlBytes(ValueType* table, unsigned tableSize, const T& key, unsigned h) -> ValueType*
+    {
+        const uint8_t* controlBytes = this->controlBytes(table, tableSize);
+        uint8_t controlHash = hashTableControlHash(h);
+        unsigned groupMask = tableSize / hashTableControlGroupSize - 1;
+        unsigned group = hashTableControlGroupHash(h) & groupMask;
+
+#if DUMP_HASHTABLE_STATS
+        ++HashTableStats::numAccesses;
+        unsigned probeCount = 0;
+#endif
+
+#if DUMP_HASHTABLE_STATS_PER_TABLE
+        ++m_stats->numAccesses;
+#endif
+
+        for (unsigned step = 1; ; ++step) {
+            unsigned groupStart = group * hashTableControlGroupSize;
+            HashTableControlGroup controlGroup(controlBytes + groupStart);
+            for (unsigned matches = controlGroup.match(controlHash); matches; matches &= matches - 1) {
+                ValueType* entry = table + groupStart + HashTableControlGroup::firstIndex(matches);
+                if (HashTranslator::equal(Extractor::extract(*entry), key))
+                    return entry;
+            }
+
+            if (controlGroup.matchEmpty())
+                return 0;
+#if DUMP_HASHTABLE_STATS
+            ++probeCount;
+            HashTableStats::recordCollisionAtCount(probeCount);
+#endif
+
+#if DUMP_HASHTABLE_STATS_PER_TABLE
+            m_stats->recordCollisionAtCount(probeCount);
+#endif
+
+            group = (group + step) & groupMask;
+        }
+    }
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    template<typename HashTranslator, typename T>
+    inline auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::lookupForWritingWithControlBytes(const T& key, unsigned h) -> LookupType
+    {
+        ValueType* table = m_table;
+        const uint8_t* controlBytes = this->controlBytes();
+        uint8_t controlHash = hashTableControlHash(h);
+        unsigned groupMask = m_tableSize / hashTableControlGroupSize - 1;
+        unsigned group = hashTableControlGroupHash(h) & groupMask;
+
+#if DUMP_HASHTABLE_STATS
+        ++HashTableStats::numAccesses;
+        unsigned probeCount = 0;
+#endif
+
+#if DUMP_HASHTABLE_STATS_PER_TABLE
+        ++m_stats->numAccesses;
+#endif
+
+        ValueType* insertionEntry = 0;
+
+        for (unsigned step = 1; ; ++step) {
+            unsigned groupStart = group * hashTableControlGroupSize;
+            HashTableControlGroup controlGroup(controlBytes + groupStart);
+            for (unsigned matches = controlGroup.match(controlHash); matches; matches &= matches - 1) {
+                ValueType* entry = table + groupStart + HashTableControlGroup::firstIndex(matches);
+                if (HashTranslator::equal(Extractor::extract(*entry), key))
+                    return LookupType(entry, true);
+            }
+
+            if (!insertionEntry) {
+                if (unsigned available = controlGroup.matchEmptyOrDeleted())
+                    insertionEntry = table + groupStart + HashTableControlGroup::firstIndex(available);
+            }
+
+            if (controlGroup.matchEmpty())
+                return LookupType(insertionEntry, false);
+#if DUMP_HASHTABLE_STATS
+            ++probeCount;
+            HashTableStats::recordCollisionAtCount(probeCount);
+#endif
+
+#if DUMP_HASHTABLE_STATS_PER_TABLE
+            m_stats->recordCollisionAtCount(probeCount);
+#endif
+
+            group = (group + step) & groupMask;
+        }
+    }
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    inline auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::insertionBucketWithControlBytes(unsigned h) -> ValueType*
+    {
+        const uint8_t* controlBytes = this->controlBytes();
+        unsigned groupMask = m_tableSize / hashTableControlGroupSize - 1;
+        unsigned group = hashTableControlGroupHash(h) & groupMask;
+
+        for (unsigned step = 1; ; ++step) {
+            unsigned groupStart = group * hashTableControlGroupSize;
+            if (unsigned available = HashTableControlGroup(controlBytes + groupStart).matchEmptyOrDeleted())
+                return m_table + groupStart + HashTableControlGroup::firstIndex(available);
+            group = (group + step) & groupMask;
+        }
+    }
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    template<typename HashTranslator, typename T>
+    inline auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::lookupInTable(ValueType* table, unsigned tableSize, const T& key, unsigned h) -> ValueType*
+    {
+        if (KeyTraits::usesControlBytes)
+            return lookupWithControlBytes<HashTranslator>(table, tableSize, key, h);
+
+        unsigned k = 0;
+        unsigned sizeMask = tableSize - 1;
+        unsigned i = h & sizeMask;
+
+        while (1) {
+            ValueType* entry = table + i;
+
+            if (isEmptyBucket(*entry))
+                return 0;
+
+            if (!isDeletedBucket(*entry) && HashTranslator::equal(Extractor::extract(*entry), key))
+                return entry;
+
+            if (k == 0)
+                k = 1 | doubleHash(h);
+            i = (i + k) & sizeMask;
+        }
+    }
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    template<typename HashTranslator, typename T>
+    inline auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::lookupInOldTable(const T& key, unsigned h) -> ValueType*
+    {
+        ASSERT(this->oldTable());
+#if DUMP_HASHTABLE_STATS_PER_TABLE
+        ++m_stats->numOldTableLookups;
+#endif
+        return lookupInTable<HashTranslator>(this->oldTable(), this->oldTableSize(), key, h);
+    }
+
     template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
     template<typename HashTranslator, typename T, typename Extra>
     ALWAYS_INLINE void HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::addUniqueForInitialization(T&& key, Extra&& extra)
@@ -798,6 +1193,14 @@ namespace WTF {
         unsigned h = HashTranslator::hash(key);
         unsigned i = h & sizeMask;
 
+        if (KeyTraits::usesControlBytes) {
+            ValueType* entry = insertionBucketWithControlBytes(h);
+            HashTranslator::translate(*entry, std::forward<T>(key), std::forward<Extra>(extra));
+            setControlByte(entry, hashTableControlHash(h));
+            internalCheckTableConsistency();
+            return;
+        }
+
 #if DUMP_HASHTABLE_STATS
         ++HashTableStats::numAccesses;
         unsigned probeCount = 0;
@@ -879,6 +1282,37 @@ namespace WTF {
         unsigned h = HashTranslator::hash(key);
         unsigned i = h & sizeMask;
 
+        if (KeyTraits::usesControlBytes) {
+            LookupType lookupResult = lookupForWritingWithControlBytes<HashTranslator>(key, h);
+            ValueType* entry = lookupResult.first;
+            if (lookupResult.second)
+                return AddResult(makeKnownGoodIterator(entry), false);
+
+            if (this->oldTable()) {
+                if (ValueType* oldEntry = lookupInOldTable<HashTranslator>(key, h))
+                    return AddResult(makeKnownGoodIterator(oldEntry), false);
+            }
+
+            if (isDeletedBucket(*entry)) {
+                initializeBucket(*entry);
+                --m_deletedCount;
+            }
+
+            HashTranslator::translate(*entry, std::forward<T>(key), std::forward<Extra>(extra));
+            setControlByte(entry, hashTableControlHash(h));
+            ++m_keyCount;
+
+            if (this->oldTable())
+                continueIncrementalRehash();
+
+            if (shouldExpand())
+                entry = expand(entry);
+
+            internalCheckTableConsistency();
+
+            return AddResult(makeKnownGoodIterator(entry), true);
+        }
+
 #if DUMP_HASHTABLE_STATS
         ++HashTableStats::numAccesses;
         unsigned probeCount = 0;
@@ -926,6 +1360,11 @@ namespace WTF {
             i = (i + k) & sizeMask;
         }
 
+        if (this->oldTable()) {
+            if (ValueType* oldEntry = lookupInOldTable<HashTranslator>(key, h))
+                return AddResult(makeKnownGoodIterator(oldEntry), false);
+        }
+
         if (deletedEntry) {
             initializeBucket(*deletedEntry);
             entry = deletedEntry;
@@ -934,6 +1373,9 @@ namespace WTF {
 
         HashTranslator::translate(*entry, std::forward<T>(key), std::forward<Extra>(extra));
         ++m_keyCount;
+
+        if (this->oldTable())
+            continueIncrementalRehash();
         
         if (shouldExpand())
             entry = expand(entry);
@@ -964,6 +1406,11 @@ namespace WTF {
         
         if (found)
             return AddResult(makeKnownGoodIterator(entry), false);
+
+        if (this->oldTable()) {
+            if (ValueType* oldEntry = lookupInOldTable<HashTranslator>(key, h))
+                return AddResult(makeKnownGoodIterator(oldEntry), false);
+        }
         
         if (isDeletedBucket(*entry)) {
             initializeBucket(*entry);
@@ -971,8 +1418,13 @@ namespace WTF {
         }
 
         HashTranslator::translate(*entry, std::forward<T>(key), std::forward<Extra>(extra), h);
+        if (KeyTraits::usesControlBytes)
+            setControlByte(entry, hashTableControlHash(h));
         ++m_keyCount;
 
+        if (this->oldTable())
+            continueIncrementalRehash();
+
         if (shouldExpand())
             entry = expand(entry);
 
@@ -994,7 +1446,15 @@ namespace WTF {
         ++m_stats->numReinserts;
 #endif
 
-        Value* newEntry = lookupForWriting(Extractor::extract(entry)).first;
+        Value* newEntry;
+        if (KeyTraits::usesControlBytes) {
+            // The new table has no deleted buckets and does not contain the key yet,
+            // so there is no need to compare keys.
+            unsigned h = IdentityTranslatorType::hash(Extractor::extract(entry));
+            newEntry = insertionBucketWithControlBytes(h);
+            setControlByte(newEntry, hashTableControlHash(h));
+        } else
+            newEntry = lookupForWriting(Extractor::extract(entry)).first;
         newEntry->~Value();
         new (NotNull, newEntry) ValueType(WTFMove(entry));
 
@@ -1064,10 +1524,22 @@ namespace WTF {
         ++m_stats->numRemoves;
 #endif
 
-        deleteBucket(*pos);
-        ++m_deletedCount;
+        if (isInOldTable(pos)) {
+            // Buckets removed from the old table are skipped by the migration, so they do not count as deleted.
+            deleteBucket(*pos);
+            if (KeyTraits::usesControlBytes)
+                controlBytes(this->oldTable(), this->oldTableSize())[pos - this->oldTable()] = hashTableControlDeleted;
+        } else {
+            deleteBucket(*pos);
+            if (KeyTraits::usesControlBytes)
+                setControlByte(pos, hashTableControlDeleted);
+            ++m_deletedCount;
+        }
         --m_keyCount;
 
+        if (this->oldTable())
+            continueIncrementalRehash();
+
         if (shouldShrink())
             shrink();
 
@@ -1126,11 +1598,31 @@ namespace WTF {
                 continue;
             
             deleteBucket(bucket);
+            if (KeyTraits::usesControlBytes)
+                setControlByte(&bucket, hashTableControlDeleted);
             ++removedBucketCount;
         }
         m_deletedCount += removedBucketCount;
         m_keyCount -= removedBucketCount;
 
+        if (ValueType* oldTable = this->oldTable()) {
+            unsigned removedOldBucketCount = 0;
+            for (unsigned i = this->oldTableSize(); i-- > this->oldTableMigrationIndex();) {
+                ValueType& bucket = oldTable[i];
+                if (isEmptyOrDeletedBucket(bucket))
+                    continue;
+
+                if (!functor(bucket))
+                    continue;
+
+                deleteBucket(bucket);
+                if (KeyTraits::usesControlBytes)
+                    controlBytes(oldTable, this->oldTableSize())[i] = hashTableControlDeleted;
+                ++removedOldBucketCount;
+            }
+            m_keyCount -= removedOldBucketCount;
+        }
+
         if (shouldShrink())
             shrink();
         
@@ -1140,13 +1632,23 @@ namespace WTF {
     template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
     auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::allocateTable(unsigned size) -> ValueType*
     {
+        // Control bytes, if any, live right after the buckets in the same allocation.
+        size_t allocationSize = size * sizeof(ValueType);
+        if (KeyTraits::usesControlBytes)
+            allocationSize += size;
+
         // would use a template member function with explicit specializations here, but
         // gcc doesn't appear to support that
+        ValueType* result;
         if (Traits::emptyValueIsZero)
-            return static_cast<ValueType*>(fastZeroedMalloc(size * sizeof(ValueType)));
-        ValueType* result = static_cast<ValueType*>(fastMalloc(size * sizeof(ValueType)));
-        for (unsigned i = 0; i < size; i++)
-            initializeBucket(result[i]);
+            result = static_cast<ValueType*>(fastZeroedMalloc(allocationSize));
+        else {
+            result = static_cast<ValueType*>(fastMalloc(allocationSize));
+            for (unsigned i = 0; i < size; i++)
+                initializeBucket(result[i]);
+        }
+        if (KeyTraits::usesControlBytes)
+            memset(reinterpret_cast<uint8_t*>(result + size), hashTableControlEmpty, size);
         return result;
     }
 
@@ -1165,7 +1667,7 @@ namespace WTF {
     {
         unsigned newSize;
         if (m_tableSize == 0)
-            newSize = KeyTraits::minimumTableSize;
+            newSize = m_minimumTableSize;
         else if (mustRehashInPlace())
             newSize = m_tableSize;
         else
@@ -1177,6 +1679,13 @@ namespace WTF {
     template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
     auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::rehash(unsigned newTableSize, ValueType* entry) -> ValueType*
     {
+        // The entry, if any, was just added to the current table, so finishing a pending migration does not move it.
+        if (this->oldTable())
+            finishIncrementalRehash();
+
+        if (KeyTraits::usesIncrementalRehash && m_tableSize >= m_incrementalRehashMinimumTableSize)
+            return beginIncrementalRehash(newTableSize, entry);
+
         internalCheckTableConsistencyExceptSize();
 
         unsigned oldTableSize = m_tableSize;
@@ -1218,6 +1727,101 @@ namespace WTF {
         return newEntry;
     }
 
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::beginIncrementalRehash(unsigned newTableSize, ValueType* entry) -> ValueType*
+    {
+        ASSERT(!this->oldTable());
+        internalCheckTableConsistencyExceptSize();
+
+#if DUMP_HASHTABLE_STATS
+        ++HashTableStats::numRehashes;
+#endif
+
+#if DUMP_HASHTABLE_STATS_PER_TABLE
+        ++m_stats->numRehashes;
+#endif
+
+        this->setOldTable(m_table, m_tableSize);
+
+        m_tableSize = newTableSize;
+        m_tableSizeMask = newTableSize - 1;
+        m_table = allocateTable(newTableSize);
+        m_deletedCount = 0;
+
+        // The caller holds on to the entry it just added, so that one has to move right away.
+        ValueType* newEntry = entry ? migrateBucket(*entry) : nullptr;
+
+        internalCheckTableConsistencyExceptSize();
+        return newEntry;
+    }
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    void HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::continueIncrementalRehash()
+    {
+        ValueType* oldTable = this->oldTable();
+        unsigned oldTableSize = this->oldTableSize();
+        ASSERT(oldTable);
+
+        unsigned index = this->oldTableMigrationIndex();
+        unsigned endIndex = std::min(index + m_incrementalRehashStepSize, oldTableSize);
+        for (; index < endIndex; ++index) {
+            if (!isEmptyOrDeletedBucket(oldTable[index]))
+                migrateBucket(oldTable[index]);
+        }
+
+        if (endIndex < oldTableSize) {
+            this->setOldTableMigrationIndex(endIndex);
+            return;
+        }
+
+        this->setOldTable(nullptr, 0);
+        deallocateTable(oldTable, oldTableSize);
+    }
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    void HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::finishIncrementalRehash()
+    {
+        while (this->oldTable())
+            continueIncrementalRehash();
+    }
+
+    template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
+    auto HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::migrateBucket(ValueType& bucket) -> ValueType*
+    {
+        ASSERT(isInOldTable(&bucket));
+        ASSERT(!isEmptyOrDeletedBucket(bucket));
+
+#if DUMP_HASHTABLE_STATS
+        ++HashTableStats::numReinserts;
+#endif
+#if DUMP_HASHTABLE_STATS_PER_TABLE
+        ++m_stats->numMigratedBuckets;
+#endif
+
+        // Unlike reinsert(), the new table may already have deleted buckets.
+        ValueType* newEntry;
+        if (KeyTraits::usesControlBytes) {
+            unsigned h = IdentityTranslatorType::hash(Extractor::extract(bucket));
+            newEntry = insertionBucketWithControlBytes(h);
+            setControlByte(newEntry, hashTableControlHash(h));
+        } else
+            newEntry = lookupForWriting(Extractor::extract(bucket)).first;
+
+        if (isDeletedBucket(*newEntry)) {
+            initializeBucket(*newEntry);
+            --m_deletedCount;
+        }
+
+        newEntry->~Value();
+        new (NotNull, newEntry) ValueType(WTFMove(bucket));
+
+        deleteBucket(bucket);
+        if (KeyTraits::usesControlBytes)
+            controlBytes(this->oldTable(), this->oldTableSize())[&bucket - this->oldTable()] = hashTableControlDeleted;
+
+        return newEntry;
+    }
+
     template<typename Key, typename Value, typename Extractor, typename HashFunctions, typename Traits, typename KeyTraits>
     void HashTable<Key, Value, Extractor, HashFunctions, Traits, KeyTraits>::clear()
     {
@@ -1226,6 +1830,10 @@ namespace WTF {
             return;
 
         deallocateTable(m_table, m_tableSize);
+        if (ValueType* oldTable = this->oldTable()) {
+            deallocateTable(oldTable, this->oldTableSize());
+            this->setOldTable(nullptr, 0);
+        }
         m_table = 0;
         m_tableSize = 0;
         m_tableSizeMask = 0;
@@ -1261,7 +1869,14 @@ namespace WTF {
         if (aboveThreeQuarterLoad)
             bestTableSize *= 2;
 
-        unsigned minimumTableSize = KeyTraits::minimumTableSize;
+        // Tables with control bytes can be filled up to 7/8, so give them the smallest power of two that stays below that.
+        if (KeyTraits::usesControlBytes) {
+            bestTableSize = WTF::roundUpToPowerOfTwo(otherKeyCount);
+            if (otherKeyCount * m_maxLoadWithControlBytesDenominator >= bestTableSize * m_maxLoadWithControlBytesNumerator)
+                bestTableSize *= 2;
+        }
+
+        unsigned minimumTableSize = m_minimumTableSize;
         m_tableSize = std::max<unsigned>(bestTableSize, minimumTableSize);
         m_tableSizeMask = m_tableSize - 1;
         m_keyCount = otherKeyCount;
@@ -1282,6 +1897,7 @@ namespace WTF {
         std::swap(m_tableSizeMask, other.m_tableSizeMask);
         std::swap(m_keyCount, other.m_keyCount);
         std::swap(m_deletedCount, other.m_deletedCount);
+        this->swapOldTable(other);
 
 #if DUMP_HASHTABLE_STATS_PER_TABLE
         m_stats.swap(other.m_stats);
@@ -1317,6 +1933,8 @@ namespace WTF {
         other.m_keyCount = 0;
         other.m_deletedCount = 0;
 
+        this->swapOldTable(other);
+
 #if DUMP_HASHTABLE_STATS_PER_TABLE
         m_stats = WTFMove(other.m_stats);
         other.m_stats = nullptr;
@@ -1351,14 +1969,18 @@ namespace WTF {
         unsigned deletedCount = 0;
         for (unsigned j = 0; j < m_tableSize; ++j) {
             ValueType* entry = m_table + j;
-            if (isEmptyBucket(*entry))
+            if (isEmptyBucket(*entry)) {
+                ASSERT(!KeyTraits::usesControlBytes || controlBytes()[j] == hashTableControlEmpty);
                 continue;
+            }
 
             if (isDeletedBucket(*entry)) {
+                ASSERT(!KeyTraits::usesControlBytes || controlBytes()[j] == hashTableControlDeleted);
                 ++deletedCount;
                 continue;
             }
 
+            ASSERT(!KeyTraits::usesControlBytes || controlBytes()[j] == hashTableControlHash(IdentityTranslatorType::hash(Extractor::extract(*entry))));
             const_iterator it = find(Extractor::extract(*entry));
             ASSERT(entry == it.m_position);
             ++count;
@@ -1366,9 +1988,22 @@ namespace WTF {
             ValueCheck<Key>::checkConsistency(it->key);
         }
 
+        if (ValueType* oldTable = this->oldTable()) {
+            for (unsigned j = 0; j < this->oldTableSize(); ++j) {
+                ValueType* entry = oldTable + j;
+                if (isEmptyOrDeletedBucket(*entry))
+                    continue;
+
+                ASSERT(j >= this->oldTableMigrationIndex());
+                const_iterator it = find(Extractor::extract(*entry));
+                ASSERT(entry == it.m_position);
+                ++count;
+            }
+        }
+
         ASSERT(count == m_keyCount);
         ASSERT(deletedCount == m_deletedCount);
-        ASSERT(m_tableSize >= KeyTraits::minimumTableSize);
+        ASSERT(m_tableSize >= m_minimumTableSize);
         ASSERT(m_tableSizeMask);
         ASSERT(m_tableSize == m_tableSizeMask + 1);
     }
@@ -47,6 +47,17 @@ template<typename T> struct GenericHashTraitsBase<false, T> {
     // The starting table size. Can be overridden when we know beforehand that
     // a hash table will have at least N entries.
     static const unsigned minimumTableSize = 8;
+
+    // The usesControlBytes flag switches the hash table to a layout with a one byte control array
+    // next to the buckets, probed a group of 16 buckets at a time. Lookups mostly touch the control
+    // bytes instead of the buckets, which lets the table run at a 7/8 maximum load instead of 1/2.
+    // It pays off for large tables and for keys that are expensive to compare.
+    static const bool usesControlBytes = false;
+
+    // The usesIncrementalRehash flag makes large tables grow and shrink incrementally: the previous
+    // buckets stay allocated and a few of them are moved over on every add or remove, so no single
+    // operation pays for rehashing the whole table.
+    static const bool usesIncrementalRehash = false;
 };
 
 // Default integer traits disallow both 0 and -1 as keys (max value instead of -1 for unsigned).
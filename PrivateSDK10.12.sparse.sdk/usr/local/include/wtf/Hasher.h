@@ -55,9 +55,7 @@ public:
     void addCharactersAssumingAligned(UChar a, UChar b)
     {
         ASSERT(!m_hasPendingCharacter);
-        m_hash += a;
-        m_hash = (m_hash << 16) ^ ((b << 11) ^ m_hash);
-        m_hash += m_hash >> 11;
+        m_hash = calculateWithTwoCharacters(m_hash, a, b);
     }
 
     void addCharacter(UChar character)
@@ -89,19 +87,26 @@ public:
         addCharactersAssumingAligned(a, b);
     }
 
+    // This is the path used to hash whole strings, so it hashes four characters per iteration and keeps
+    // the running hash in a local. The result is the same as adding the characters one pair at a time.
     template<typename T, UChar Converter(T)> void addCharactersAssumingAligned(const T* data, unsigned length)
     {
         ASSERT(!m_hasPendingCharacter);
 
-        bool remainder = length & 1;
-        length >>= 1;
-
-        while (length--) {
-            addCharactersAssumingAligned(Converter(data[0]), Converter(data[1]));
+        unsigned hash = m_hash;
+        const T* end = data + (length & ~3U);
+        while (data != end) {
+            hash = calculateWithTwoCharacters(hash, Converter(data[0]), Converter(data[1]));
+            hash = calculateWithTwoCharacters(hash, Converter(data[2]), Converter(data[3]));
+            data += 4;
+        }
+        if (length & 2) {
+            hash = calculateWithTwoCharacters(hash, Converter(data[0]), Converter(data[1]));
             data += 2;
         }
+        m_hash = hash;
 
-        if (remainder)
+        if (length & 1)
             addCharacter(Converter(*data));
     }
 
@@ -264,6 +269,14 @@ private:
         return character;
     }
 
+    static unsigned calculateWithTwoCharacters(unsigned hash, UChar a, UChar b)
+    {
+        hash += a;
+        hash = (hash << 16) ^ ((b << 11) ^ hash);
+        hash += hash >> 11;
+        return hash;
+    }
+
     unsigned avalancheBits() const
     {
         unsigned result = m_hash;
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WTF_LRUCache_h
+#define WTF_LRUCache_h
+
+#include <array>
+#include <memory>
+#include <wtf/Assertions.h>
+#include <wtf/DoublyLinkedList.h>
+#include <wtf/HashFunctions.h>
+#include <wtf/HashMap.h>
+#include <wtf/Lock.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Optional.h>
+
+namespace WTF {
+
+template<typename KeyType, typename ValueType>
+struct LRUCachePolicy {
+    // How much of the cache's capacity an entry takes up, computed once when the entry is added.
+    // Counting every entry as 1 makes the capacity an entry count; returning a size in bytes makes
+    // it a byte budget.
+    static size_t cost(const KeyType&, const ValueType&) { return 1; }
+
+    // Called on each entry that is dropped to make room, just before it is destroyed. Not called
+    // for entries that are removed or cleared explicitly.
+    static void willEvict(const KeyType&, ValueType&) { }
+};
+
+// A least-recently-used cache with O(1) lookup, insertion and eviction. Entries live in a HashMap
+// and are threaded, least recently used first, onto a doubly linked list; a hit moves the entry to
+// the end of the list. Unlike TinyLRUCache, this works for caches of any size. It is not thread-safe;
+// see ShardedLRUCache for that.
+template<typename KeyType, typename ValueType, typename Policy = LRUCachePolicy<KeyType, ValueType>, typename HashArg = typename DefaultHash<KeyType>::Hash, typename KeyTraitsArg = HashTraits<KeyType>>
+class LRUCache {
+    WTF_MAKE_NONCOPYABLE(LRUCache);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    explicit LRUCache(size_t capacity)
+        : m_capacity(capacity)
+    {
+    }
+
+    ~LRUCache()
+    {
+        clear();
+    }
+
+    size_t capacity() const { return m_capacity; }
+    size_t cost() const { return m_cost; }
+    unsigned size() const { return m_map.size(); }
+    bool isEmpty() const { return m_map.isEmpty(); }
+
+    // Evicts least recently used entries until the cache fits the new capacity.
+    void setCapacity(size_t capacity)
+    {
+        m_capacity = capacity;
+        evictToFit(0);
+    }
+
+    // Returns the cached value and marks it as most recently used, or returns null on a miss. The
+    // pointer is valid until the next call that adds or removes entries.
+    ValueType* get(const KeyType& key)
+    {
+        Node* node = m_map.get(key);
+        if (!node)
+            return nullptr;
+        touch(node);
+        return &node->value;
+    }
+
+    // Like get(), but does not change the entry's recency.
+    ValueType* peek(const KeyType& key) const
+    {
+        Node* node = m_map.get(key);
+        return node ? &node->value : nullptr;
+    }
+
+    bool contains(const KeyType& key) const { return m_map.contains(key); }
+
+    // Adds or replaces the value for key, then evicts until the cache fits. A value whose cost
+    // alone exceeds the capacity is not cached. Returns the cached value, or null if it was not cached.
+    template<typename V>
+    ValueType* set(const KeyType& key, V&& value)
+    {
+        size_t cost = Policy::cost(key, value);
+        // Build the node before dropping the old entry, in case value refers to it.
+        std::unique_ptr<Node> node = std::make_unique<Node>(key, std::forward<V>(value), cost);
+        remove(key);
+        if (cost > m_capacity)
+            return nullptr;
+
+        evictToFit(cost);
+        Node* result = node.get();
+        m_map.add(key, node.release());
+        m_list.append(result);
+        m_cost += cost;
+        return &result->value;
+    }
+
+    // Returns the cached value for key, creating it with functor() on a miss.
+    template<typename Functor>
+    ValueType* ensure(const KeyType& key, const Functor& functor)
+    {
+        if (ValueType* value = get(key))
+            return value;
+        return set(key, functor());
+    }
+
+    bool remove(const KeyType& key)
+    {
+        Node* node = m_map.take(key);
+        if (!node)
+            return false;
+        m_list.remove(node);
+        m_cost -= node->cost;
+        delete node;
+        return true;
+    }
+
+    void clear()
+    {
+        while (Node* node = m_list.removeHead())
+            delete node;
+        m_map.clear();
+        m_cost = 0;
+    }
+
+private:
+    struct Node : public DoublyLinkedListNode<Node> {
+        WTF_MAKE_FAST_ALLOCATED;
+    public:
+        template<typename V>
+        Node(const KeyType& key, V&& value, size_t cost)
+            : key(key)
+            , value(std::forward<V>(value))
+            , cost(cost)
+        {
+        }
+
+        KeyType key;
+        ValueType value;
+        size_t cost;
+        Node* m_prev;
+        Node* m_next;
+    };
+
+    void touch(Node* node)
+    {
+        if (node == m_list.tail())
+            return;
+        m_list.remove(node);
+        m_list.append(node);
+    }
+
+    void evictToFit(size_t incomingCost)
+    {
+        while (m_cost + incomingCost > m_capacity) {
+            Node* node = m_list.removeHead();
+            ASSERT(node);
+            Policy::willEvict(node->key, node->value);
+            m_map.remove(node->key);
+            m_cost -= node->cost;
+            delete node;
+        }
+    }
+
+    HashMap<KeyType, Node*, HashArg, KeyTraitsArg> m_map;
+    DoublyLinkedList<Node> m_list;
+    size_t m_capacity;
+    size_t m_cost { 0 };
+};
+
+// An LRUCache split into independently locked shards, picked by key hash, so that threads working
+// on different keys rarely contend. Recency and capacity are tracked per shard, which makes the
+// eviction order approximate across the whole cache. Values are returned by copy, since a pointer
+// into a shard would outlive its lock.
+template<typename KeyType, typename ValueType, typename Policy = LRUCachePolicy<KeyType, ValueType>, typename HashArg = typename DefaultHash<KeyType>::Hash, typename KeyTraitsArg = HashTraits<KeyType>, unsigned shardCount = 16>
+class ShardedLRUCache {
+    WTF_MAKE_NONCOPYABLE(ShardedLRUCache);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    typedef LRUCache<KeyType, ValueType, Policy, HashArg, KeyTraitsArg> Cache;
+
+    // The capacity is divided evenly among the shards.
+    explicit ShardedLRUCache(size_t capacity)
+    {
+        for (auto& shard : m_shards)
+            shard = std::make_unique<Shard>((capacity + shardCount - 1) / shardCount);
+    }
+
+    Optional<ValueType> get(const KeyType& key)
+    {
+        Shard& shard = shardFor(key);
+        LockHolder locker(shard.lock);
+        if (ValueType* value = shard.cache.get(key))
+            return *value;
+        return Nullopt;
+    }
+
+    template<typename V>
+    void set(const KeyType& key, V&& value)
+    {
+        Shard& shard = shardFor(key);
+        LockHolder locker(shard.lock);
+        shard.cache.set(key, std::forward<V>(value));
+    }
+
+    // functor() runs with the shard locked, so it must not call back into this cache.
+    template<typename Functor>
+    Optional<ValueType> ensure(const KeyType& key, const Functor& functor)
+    {
+        Shard& shard = shardFor(key);
+        LockHolder locker(shard.lock);
+        if (ValueType* value = shard.cache.ensure(key, functor))
+            return *value;
+        return Nullopt;
+    }
+
+    bool remove(const KeyType& key)
+    {
+        Shard& shard = shardFor(key);
+        LockHolder locker(shard.lock);
+        return shard.cache.remove(key);
+    }
+
+    void clear()
+    {
+        for (auto& shard : m_shards) {
+            LockHolder locker(shard->lock);
+            shard->cache.clear();
+        }
+    }
+
+    size_t cost()
+    {
+        size_t result = 0;
+        for (auto& shard : m_shards) {
+            LockHolder locker(shard->lock);
+            result += shard->cache.cost();
+        }
+        return result;
+    }
+
+private:
+    struct Shard {
+        WTF_MAKE_FAST_ALLOCATED;
+    public:
+        explicit Shard(size_t capacity)
+            : cache(capacity)
+        {
+        }
+
+        Lock lock;
+        Cache cache;
+    };
+
+    Shard& shardFor(const KeyType& key)
+    {
+        // Rehash so that tables keyed by, say, aligned pointers still spread across the shards.
+        return *m_shards[intHash(HashArg::hash(key)) % shardCount];
+    }
+
+    std::array<std::unique_ptr<Shard>, shardCount> m_shards;
+};
+
+} // namespace WTF
+
+using WTF::LRUCache;
+using WTF::LRUCachePolicy;
+using WTF::ShardedLRUCache;
+
+#endif // WTF_LRUCache_h
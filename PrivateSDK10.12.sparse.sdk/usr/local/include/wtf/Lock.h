@@ -31,6 +31,10 @@
 #include <wtf/Locker.h>
 #include <wtf/Noncopyable.h>
 
+#if ENABLE(LOCK_PROFILING)
+#include <wtf/LockProfiler.h>
+#endif
+
 namespace TestWebKitAPI {
 struct LockInspector;
 };
@@ -53,6 +57,12 @@ struct LockBase {
             return;
         }
 
+#if ENABLE(LOCK_PROFILING)
+        if (UNLIKELY(LockProfiler::isEnabled())) {
+            LockProfiler::lockSlow(*this);
+            return;
+        }
+#endif
         lockSlow();
     }
 
@@ -75,6 +85,10 @@ struct LockBase {
 
     void unlock()
     {
+#if ENABLE(LOCK_PROFILING)
+        if (UNLIKELY(LockProfiler::isEnabled()))
+            LockProfiler::willUnlock(this);
+#endif
         if (LIKELY(m_byte.compareExchangeWeak(isHeldBit, 0, std::memory_order_release))) {
             // Lock released and nobody was waiting!
             return;
@@ -95,6 +109,9 @@ struct LockBase {
 
 protected:
     friend struct TestWebKitAPI::LockInspector;
+#if ENABLE(LOCK_PROFILING)
+    friend class LockProfiler;
+#endif
     
     static const uint8_t isHeldBit = 1;
     static const uint8_t hasParkedBit = 2;
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WTF_LockProfiler_h
+#define WTF_LockProfiler_h
+
+#include <algorithm>
+#include <mutex>
+#include <wtf/Atomics.h>
+#include <wtf/CurrentTime.h>
+#include <wtf/HashFunctions.h>
+#include <wtf/PrintStream.h>
+#include <wtf/RawPointer.h>
+#include <wtf/ThreadSpecific.h>
+#include <wtf/Vector.h>
+
+#if OS(DARWIN) || OS(LINUX)
+#include <dlfcn.h>
+#endif
+
+namespace WTF {
+
+// Contention statistics for one lock acquired from one call site. Only contended acquisitions, the
+// ones that missed the inline fast path, are counted; the hold time of a contended acquisition runs
+// until the same thread unlocks the lock.
+struct LockContentionRecord {
+    const void* lockAddress { nullptr };
+    const void* callSite { nullptr };
+    const char* name { nullptr };
+    uint64_t contendedCount { 0 };
+    uint64_t holdCount { 0 };
+    double totalWaitTime { 0 };
+    double maxWaitTime { 0 };
+    double totalHoldTime { 0 };
+    double maxHoldTime { 0 };
+
+    void merge(const LockContentionRecord& other)
+    {
+        contendedCount += other.contendedCount;
+        holdCount += other.holdCount;
+        totalWaitTime += other.totalWaitTime;
+        maxWaitTime = std::max(maxWaitTime, other.maxWaitTime);
+        totalHoldTime += other.totalHoldTime;
+        maxHoldTime = std::max(maxHoldTime, other.maxHoldTime);
+    }
+
+    void dump(PrintStream& out) const
+    {
+        out.print("lock ", RawPointer(lockAddress));
+        if (name)
+            out.print(" (", name, ")");
+        out.print(" at ");
+#if OS(DARWIN) || OS(LINUX)
+        Dl_info info;
+        if (callSite && dladdr(callSite, &info) && info.dli_sname)
+            out.print(info.dli_sname, "+", static_cast<uintptr_t>(static_cast<const char*>(callSite) - static_cast<const char*>(info.dli_saddr)));
+        else
+#endif
+            out.print(RawPointer(callSite));
+        out.print(": ", contendedCount, " contended, wait ", totalWaitTime * 1000, " ms total / ", maxWaitTime * 1000, " ms max");
+        if (holdCount)
+            out.print(", hold ", totalHoldTime * 1000, " ms total / ", maxHoldTime * 1000, " ms max");
+    }
+};
+
+// An open-addressed table of records keyed by (lock, call site). It does not use HashMap because
+// HashTable itself uses Lock.
+class LockContentionTable {
+public:
+    LockContentionRecord& add(const void* lockAddress, const void* callSite)
+    {
+        ASSERT(lockAddress);
+        if ((m_size + 1) * 2 > m_records.size())
+            grow();
+        unsigned mask = m_records.size() - 1;
+        for (unsigned index = hash(lockAddress, callSite) & mask; ; index = (index + 1) & mask) {
+            LockContentionRecord& record = m_records[index];
+            if (!record.lockAddress) {
+                record.lockAddress = lockAddress;
+                record.callSite = callSite;
+                ++m_size;
+                return record;
+            }
+            if (record.lockAddress == lockAddress && record.callSite == callSite)
+                return record;
+        }
+    }
+
+    void merge(const LockContentionTable& other)
+    {
+        other.forEach([&] (const LockContentionRecord& record) {
+            add(record.lockAddress, record.callSite).merge(record);
+        });
+    }
+
+    template<typename Functor>
+    void forEach(const Functor& functor) const
+    {
+        for (const LockContentionRecord& record : m_records) {
+            if (record.lockAddress)
+                functor(record);
+        }
+    }
+
+    void clear()
+    {
+        m_records.clear();
+        m_size = 0;
+    }
+
+private:
+    static unsigned hash(const void* lockAddress, const void* callSite)
+    {
+        return pairIntHash(PtrHash<const void*>::hash(lockAddress), PtrHash<const void*>::hash(callSite));
+    }
+
+    void grow()
+    {
+        Vector<LockContentionRecord> oldRecords = WTFMove(m_records);
+        m_records.resize(std::max<size_t>(oldRecords.size() * 2, 16));
+        m_size = 0;
+        for (const LockContentionRecord& record : oldRecords) {
+            if (record.lockAddress)
+                add(record.lockAddress, record.callSite).merge(record);
+        }
+    }
+
+    Vector<LockContentionRecord> m_records;
+    unsigned m_size { 0 };
+};
+
+// Opt-in contention profiling for Lock and WordLock. Build with ENABLE(LOCK_PROFILING) to route the
+// lock slow paths through here, then call LockProfiler::enable() to start recording. While disabled,
+// each slow path and unlock() pays one relaxed load. Each thread records into its own table, so
+// recording never waits on another recording thread; snapshot() and dump() merge the tables.
+//
+// The profiler's own bookkeeping uses std::mutex, so it never recurses into Lock, WordLock, or
+// ParkingLot.
+//
+// The hooks live in the inline lock() and unlock() of Lock.h and WordLock.h, so only code compiled
+// with ENABLE(LOCK_PROFILING) is recorded. Like every ENABLE flag, it has to be set for the whole
+// build: WTF, JavaScriptCore, and the embedder. Against a prebuilt WTF or JavaScriptCore, the locks
+// they take (JSLock, CodeBlock and heap locks among them) are never recorded. Mixing translation
+// units built with and without the flag is an ODR violation, since lock() and unlock() then have
+// two definitions. ParkingLot offers no callback to hook instead: its parking happens inside the
+// lock slow paths, which are compiled into WTF.
+class LockProfiler {
+public:
+    static bool isEnabled()
+    {
+        return enabledFlag().load(std::memory_order_relaxed);
+    }
+
+    static void enable()
+    {
+        // Holds recorded under an earlier enable() may have been released while disabled.
+        globals().generation.exchangeAndAdd(1);
+        enabledFlag().store(true);
+    }
+
+    static void disable()
+    {
+        enabledFlag().store(false);
+    }
+
+    // Discards everything recorded so far.
+    static void reset()
+    {
+        Globals& globals = LockProfiler::globals();
+        std::lock_guard<std::mutex> locker(globals.lock);
+        globals.retired.clear();
+        for (ThreadData* thread : globals.threads) {
+            std::lock_guard<std::mutex> threadLocker(thread->lock);
+            thread->table.clear();
+        }
+    }
+
+    // Attaches a name such as "JSLock" to a lock address for dumps. The name must outlive the profiler.
+    static void setName(const void* lockAddress, const char* name)
+    {
+        Globals& globals = LockProfiler::globals();
+        std::lock_guard<std::mutex> locker(globals.lock);
+        for (auto& entry : globals.names) {
+            if (entry.first == lockAddress) {
+                entry.second = name;
+                return;
+            }
+        }
+        globals.names.append(std::make_pair(lockAddress, name));
+    }
+
+    // Returns the merged records of all threads, live and exited, sorted by total wait time.
+    static Vector<LockContentionRecord> snapshot()
+    {
+        LockContentionTable merged;
+        Vector<LockContentionRecord> result;
+        Globals& globals = LockProfiler::globals();
+        std::lock_guard<std::mutex> locker(globals.lock);
+        merged.merge(globals.retired);
+        for (ThreadData* thread : globals.threads) {
+            std::lock_guard<std::mutex> threadLocker(thread->lock);
+            merged.merge(thread->table);
+        }
+        merged.forEach([&] (const LockContentionRecord& record) {
+            result.append(record);
+            for (auto& entry : globals.names) {
+                if (entry.first == record.lockAddress)
+                    result.last().name = entry.second;
+            }
+        });
+        std::sort(result.begin(), result.end(), [] (const LockContentionRecord& a, const LockContentionRecord& b) {
+            return a.totalWaitTime > b.totalWaitTime;
+        });
+        return result;
+    }
+
+    static void dump(PrintStream& out, unsigned maxRecords = 20)
+    {
+        Vector<LockContentionRecord> records = snapshot();
+        out.print("Lock contention: ", records.size(), " lock/call site pairs\n");
+        for (unsigned i = 0; i < records.size() && i < maxRecords; ++i) {
+            out.print("    ");
+            records[i].dump(out);
+            out.print("\n");
+        }
+    }
+
+    // Called by LockBase::lock() and WordLockBase::lock() after the fast path fails. Never inlined, so
+    // that the return address identifies the call site of lock().
+    template<typename LockType>
+    static NEVER_INLINE void lockSlow(LockType& lock)
+    {
+#if COMPILER(GCC_OR_CLANG)
+        const void* callSite = __builtin_return_address(0);
+#else
+        const void* callSite = nullptr;
+#endif
+        double start = monotonicallyIncreasingTime();
+        lock.lockSlow();
+        double acquired = monotonicallyIncreasingTime();
+        didAcquireContended(&lock, callSite, acquired - start, acquired);
+    }
+
+    // Called by LockBase::unlock() and WordLockBase::unlock() while enabled.
+    static void willUnlock(const void* lockAddress)
+    {
+        ThreadSpecific<ThreadData>& threadData = LockProfiler::threadData();
+        if (!threadData.isSet())
+            return;
+        ThreadData& thread = *threadData;
+        if (!thread.heldCount)
+            return;
+        if (thread.generation != globals().generation.load(std::memory_order_relaxed)) {
+            thread.heldCount = 0;
+            return;
+        }
+        for (unsigned i = thread.heldCount; i--;) {
+            HeldLock held = thread.held[i];
+            if (held.lockAddress != lockAddress)
+                continue;
+            std::copy(thread.held + i + 1, thread.held + thread.heldCount, thread.held + i);
+            --thread.heldCount;
+            double holdTime = monotonicallyIncreasingTime() - held.acquiredTime;
+            std::lock_guard<std::mutex> locker(thread.lock);
+            LockContentionRecord& record = thread.table.add(held.lockAddress, held.callSite);
+            ++record.holdCount;
+            record.totalHoldTime += holdTime;
+            record.maxHoldTime = std::max(record.maxHoldTime, holdTime);
+            return;
+        }
+    }
+
+private:
+    struct HeldLock {
+        const void* lockAddress;
+        const void* callSite;
+        double acquiredTime;
+    };
+
+    // Locks held deeper than this are still counted, but their hold time is not.
+    static const unsigned maxHeldLocks = 16;
+
+    struct ThreadData {
+        WTF_MAKE_NONCOPYABLE(ThreadData);
+    public:
+        ThreadData()
+        {
+            Globals& globals = LockProfiler::globals();
+            std::lock_guard<std::mutex> locker(globals.lock);
+            globals.threads.append(this);
+        }
+
+        ~ThreadData()
+        {
+            Globals& globals = LockProfiler::globals();
+            std::lock_guard<std::mutex> locker(globals.lock);
+            globals.retired.merge(table);
+            globals.threads.removeFirst(this);
+        }
+
+        // Only contended by snapshot() and reset().
+        std::mutex lock;
+        LockContentionTable table;
+        HeldLock held[maxHeldLocks];
+        unsigned heldCount { 0 };
+        unsigned generation { 0 };
+    };
+
+    struct Globals {
+        std::mutex lock;
+        Vector<ThreadData*> threads;
+        LockContentionTable retired;
+        Vector<std::pair<const void*, const char*>> names;
+        Atomic<unsigned> generation;
+    };
+
+    static void didAcquireContended(const void* lockAddress, const void* callSite, double waitTime, double acquiredTime)
+    {
+        ThreadData& thread = *threadData();
+        unsigned generation = globals().generation.load(std::memory_order_relaxed);
+        if (thread.generation != generation) {
+            thread.generation = generation;
+            thread.heldCount = 0;
+        }
+        if (thread.heldCount < maxHeldLocks)
+            thread.held[thread.heldCount++] = { lockAddress, callSite, acquiredTime };
+
+        std::lock_guard<std::mutex> locker(thread.lock);
+        LockContentionRecord& record = thread.table.add(lockAddress, callSite);
+        ++record.contendedCount;
+        record.totalWaitTime += waitTime;
+        record.maxWaitTime = std::max(record.maxWaitTime, waitTime);
+    }
+
+    static Atomic<bool>& enabledFlag()
+    {
+        static Atomic<bool> enabled;
+        return enabled;
+    }
+
+    static Globals& globals()
+    {
+        static Globals* globals = new Globals();
+        return *globals;
+    }
+
+    static ThreadSpecific<ThreadData>& threadData()
+    {
+        static ThreadSpecific<ThreadData>* threadData = new ThreadSpecific<ThreadData>;
+        return *threadData;
+    }
+};
+
+} // namespace WTF
+
+using WTF::LockContentionRecord;
+using WTF::LockProfiler;
+
+#endif // WTF_LockProfiler_h
@@ -371,6 +371,43 @@ inline unsigned fastLog2(uint64_t value)
     return fastLog2(static_cast<unsigned>(value));
 }
 
+// The value must not be zero.
+inline unsigned countLeadingZeros64(uint64_t value)
+{
+    ASSERT(value);
+#if COMPILER(GCC_OR_CLANG)
+    return __builtin_clzll(value);
+#else
+    unsigned count = 0;
+    while (!(value & (1ULL << 63))) {
+        value <<= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Returns the high 64 bits of the 128-bit product and stores the low 64 bits in low.
+inline uint64_t multiplyHigh64(uint64_t left, uint64_t right, uint64_t& low)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(left) * right;
+    low = static_cast<uint64_t>(product);
+    return static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t leftLow = static_cast<uint32_t>(left);
+    uint64_t leftHigh = left >> 32;
+    uint64_t rightLow = static_cast<uint32_t>(right);
+    uint64_t rightHigh = right >> 32;
+    uint64_t lowLow = leftLow * rightLow;
+    uint64_t lowHigh = leftLow * rightHigh;
+    uint64_t highLow = leftHigh * rightLow;
+    uint64_t middle = (lowLow >> 32) + static_cast<uint32_t>(lowHigh) + static_cast<uint32_t>(highLow);
+    low = (middle << 32) | static_cast<uint32_t>(lowLow);
+    return leftHigh * rightHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+#endif
+}
+
 template <typename T>
 inline typename std::enable_if<std::is_floating_point<T>::value, T>::type safeFPDivision(T u, T v)
 {
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WTF_MultiBufferDigest_h
+#define WTF_MultiBufferDigest_h
+
+#include <stdint.h>
+#include <string.h>
+#include <wtf/Assertions.h>
+#include <wtf/FlipBytes.h>
+#include <wtf/SHA1.h>
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace WTF {
+
+struct MultiBufferDigestInput {
+    const uint8_t* data;
+    size_t length;
+};
+
+// Hashes many independent messages at once. Each message gets the same digest as SHA1::computeHash()
+// would give it. With SSE2, four small messages are hashed side by side, one per 32-bit lane; this
+// pays off for batches of small messages, such as cache keys, where a single stream spends most of
+// its time waiting on the serial round function.
+inline void computeSHA1Hashes(const MultiBufferDigestInput*, size_t count, SHA1::Digest* hashes);
+
+namespace MultiBufferDigestInternal {
+
+// Longer messages go to SHA1 one at a time. Against a single stream that uses the SHA instructions,
+// four lanes stop paying off between 512 bytes and 1KB; the plain and CommonCrypto implementations
+// are slower than that, so the threshold is conservative for them.
+static const size_t maximumBatchedMessageLength = 512;
+
+inline bool shouldBatch(const MultiBufferDigestInput& input)
+{
+    return input.length <= maximumBatchedMessageLength;
+}
+
+} // namespace MultiBufferDigestInternal
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+
+namespace MultiBufferDigestInternal {
+
+static const unsigned laneCount = 4;
+static const size_t blockSize = 64;
+
+// Feeds one message to a lane as a sequence of padded 64-byte blocks.
+class Lane {
+public:
+    void start(const uint8_t* data, size_t length)
+    {
+        m_data = data;
+        m_length = length;
+        m_blockIndex = 0;
+        // Room for the 0x80 terminator and the 64-bit length.
+        m_blockCount = (length + 72) / blockSize;
+    }
+
+    // Returns the next block, and whether it is the last one. Blocks that lie entirely within the
+    // message are read in place.
+    const uint8_t* nextBlock(bool& isLastBlock)
+    {
+        size_t blockStart = m_blockIndex * blockSize;
+        isLastBlock = ++m_blockIndex == m_blockCount;
+        if (blockStart + blockSize <= m_length)
+            return m_data + blockStart;
+
+        memset(m_buffer, 0, blockSize);
+        if (blockStart <= m_length) {
+            size_t remaining = m_length - blockStart;
+            // An empty message may come with a null data pointer.
+            if (remaining)
+                memcpy(m_buffer, m_data + blockStart, remaining);
+            m_buffer[remaining] = 0x80;
+        }
+        if (isLastBlock) {
+            uint64_t bitLength = static_cast<uint64_t>(m_length) * 8;
+            for (unsigned i = 0; i < 8; ++i)
+                m_buffer[blockSize - 1 - i] = static_cast<uint8_t>(bitLength >> (i * 8));
+        }
+        return m_buffer;
+    }
+
+private:
+    const uint8_t* m_data;
+    size_t m_length;
+    size_t m_blockIndex;
+    size_t m_blockCount;
+    uint8_t m_buffer[blockSize];
+};
+
+inline __m128i rotateLeft(__m128i value, int amount)
+{
+    return _mm_or_si128(_mm_sll_epi32(value, _mm_cvtsi32_si128(amount)), _mm_srl_epi32(value, _mm_cvtsi32_si128(32 - amount)));
+}
+
+inline __m128i loadBigEndianWord(const uint8_t* const blocks[laneCount], unsigned index)
+{
+    uint32_t words[laneCount];
+    for (unsigned lane = 0; lane < laneCount; ++lane) {
+        memcpy(&words[lane], blocks[lane] + index * 4, 4);
+        words[lane] = flipBytes(words[lane]);
+    }
+    return _mm_setr_epi32(words[0], words[1], words[2], words[3]);
+}
+
+struct SHA1Algorithm {
+    typedef SHA1::Digest Digest;
+    static const unsigned stateWordCount = 5;
+
+    static void initialize(uint32_t state[][laneCount], unsigned lane)
+    {
+        static const uint32_t initialState[stateWordCount] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        for (unsigned i = 0; i < stateWordCount; ++i)
+            state[i][lane] = initialState[i];
+    }
+
+    static void compress(uint32_t state[][laneCount], const uint8_t* const blocks[laneCount])
+    {
+        __m128i w[16];
+        for (unsigned t = 0; t < 16; ++t)
+            w[t] = loadBigEndianWord(blocks, t);
+
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(state[0]));
+        __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(state[1]));
+        __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(state[2]));
+        __m128i d = _mm_load_si128(reinterpret_cast<const __m128i*>(state[3]));
+        __m128i e = _mm_load_si128(reinterpret_cast<const __m128i*>(state[4]));
+
+        for (unsigned t = 0; t < 80; ++t) {
+            if (t >= 16)
+                w[t & 15] = rotateLeft(_mm_xor_si128(_mm_xor_si128(w[(t - 3) & 15], w[(t - 8) & 15]), _mm_xor_si128(w[(t - 14) & 15], w[t & 15])), 1);
+
+            __m128i f;
+            uint32_t k;
+            if (t < 20) {
+                f = _mm_xor_si128(d, _mm_and_si128(b, _mm_xor_si128(c, d)));
+                k = 0x5A827999;
+            } else if (t < 40) {
+                f = _mm_xor_si128(_mm_xor_si128(b, c), d);
+                k = 0x6ED9EBA1;
+            } else if (t < 60) {
+                f = _mm_or_si128(_mm_and_si128(b, c), _mm_and_si128(d, _mm_or_si128(b, c)));
+                k = 0x8F1BBCDC;
+            } else {
+                f = _mm_xor_si128(_mm_xor_si128(b, c), d);
+                k = 0xCA62C1D6;
+            }
+
+            __m128i temp = _mm_add_epi32(_mm_add_epi32(rotateLeft(a, 5), f), _mm_add_epi32(_mm_add_epi32(e, _mm_set1_epi32(k)), w[t & 15]));
+            e = d;
+            d = c;
+            c = rotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        __m128i result[stateWordCount] = { a, b, c, d, e };
+        for (unsigned i = 0; i < stateWordCount; ++i) {
+            __m128i* word = reinterpret_cast<__m128i*>(state[i]);
+            _mm_store_si128(word, _mm_add_epi32(_mm_load_si128(word), result[i]));
+        }
+    }
+
+    static void finish(const uint32_t state[][laneCount], unsigned lane, Digest& digest)
+    {
+        for (unsigned i = 0; i < stateWordCount; ++i) {
+            uint32_t word = flipBytes(state[i][lane]);
+            memcpy(digest.data() + i * 4, &word, 4);
+        }
+    }
+};
+
+template<typename Algorithm>
+void computeDigests(const MultiBufferDigestInput* inputs, size_t count, typename Algorithm::Digest* digests)
+{
+    alignas(16) uint32_t state[Algorithm::stateWordCount][laneCount];
+    static const uint8_t idleBlock[blockSize] = { };
+
+    Lane lanes[laneCount];
+    size_t laneInput[laneCount];
+    bool laneIsActive[laneCount];
+    size_t nextInput = 0;
+    unsigned activeLaneCount = 0;
+
+    // Hands the next small message to a lane as soon as the lane's previous message is done.
+    auto startLane = [&] (unsigned lane) {
+        while (nextInput < count && !shouldBatch(inputs[nextInput]))
+            ++nextInput;
+        laneIsActive[lane] = nextInput < count;
+        if (!laneIsActive[lane])
+            return;
+        laneInput[lane] = nextInput;
+        lanes[lane].start(inputs[nextInput].data, inputs[nextInput].length);
+        Algorithm::initialize(state, lane);
+        ++nextInput;
+        ++activeLaneCount;
+    };
+
+    // Lanes left idle still go through compress(), so give them a defined state too.
+    for (unsigned lane = 0; lane < laneCount; ++lane) {
+        Algorithm::initialize(state, lane);
+        startLane(lane);
+    }
+
+    while (activeLaneCount) {
+        const uint8_t* blocks[laneCount];
+        bool isLastBlock[laneCount];
+        for (unsigned lane = 0; lane < laneCount; ++lane) {
+            isLastBlock[lane] = false;
+            blocks[lane] = laneIsActive[lane] ? lanes[lane].nextBlock(isLastBlock[lane]) : idleBlock;
+        }
+
+        Algorithm::compress(state, blocks);
+
+        for (unsigned lane = 0; lane < laneCount; ++lane) {
+            if (!isLastBlock[lane])
+                continue;
+            Algorithm::finish(state, lane, digests[laneInput[lane]]);
+            --activeLaneCount;
+            startLane(lane);
+        }
+    }
+}
+
+} // namespace MultiBufferDigestInternal
+
+#endif
+
+inline void computeSHA1Hashes(const MultiBufferDigestInput* inputs, size_t count, SHA1::Digest* hashes)
+{
+    bool smallMessagesAreBatched = false;
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSE2__)
+    size_t smallMessageCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (MultiBufferDigestInternal::shouldBatch(inputs[i]))
+            ++smallMessageCount;
+    }
+    // A lone message is faster on the single-stream implementation.
+    if (smallMessageCount > 1) {
+        MultiBufferDigestInternal::computeDigests<MultiBufferDigestInternal::SHA1Algorithm>(inputs, count, hashes);
+        smallMessagesAreBatched = true;
+    }
+#endif
+    for (size_t i = 0; i < count; ++i) {
+        if (smallMessagesAreBatched && MultiBufferDigestInternal::shouldBatch(inputs[i]))
+            continue;
+        SHA1 sha1;
+        sha1.addBytes(inputs[i].data, inputs[i].length);
+        sha1.computeHash(hashes[i]);
+    }
+}
+
+} // namespace WTF
+
+using WTF::MultiBufferDigestInput;
+using WTF::computeSHA1Hashes;
+
+#endif // WTF_MultiBufferDigest_h
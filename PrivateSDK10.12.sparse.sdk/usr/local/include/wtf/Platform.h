@@ -813,6 +813,13 @@
 #define ENABLE_ALLOCATION_LOGGING 0
 #endif
 
+/* Routes contended Lock and WordLock acquisitions through LockProfiler, which records wait and
+   hold times per lock and call site once LockProfiler::enable() is called. Must be set for the
+   whole build, including WTF and JavaScriptCore; see LockProfiler.h. */
+#if !defined(ENABLE_LOCK_PROFILING)
+#define ENABLE_LOCK_PROFILING 0
+#endif
+
 /* Enable verification that that register allocations are not made within generated control flow.
    Turned on for debug builds. */
 #if !defined(ENABLE_DFG_REGISTER_ALLOCATION_VALIDATION) && ENABLE(DFG_JIT)
@@ -31,6 +31,10 @@
 #include <wtf/Locker.h>
 #include <wtf/Noncopyable.h>
 
+#if ENABLE(LOCK_PROFILING)
+#include <wtf/LockProfiler.h>
+#endif
+
 namespace TestWebKitAPI {
 struct LockInspector;
 };
@@ -50,11 +54,21 @@ struct WordLockBase {
             return;
         }
 
+#if ENABLE(LOCK_PROFILING)
+        if (UNLIKELY(LockProfiler::isEnabled())) {
+            LockProfiler::lockSlow(*this);
+            return;
+        }
+#endif
         lockSlow();
     }
 
     void unlock()
     {
+#if ENABLE(LOCK_PROFILING)
+        if (UNLIKELY(LockProfiler::isEnabled()))
+            LockProfiler::willUnlock(this);
+#endif
         if (LIKELY(m_word.compareExchangeWeak(isLockedBit, 0, std::memory_order_release))) {
             // WordLock released, and nobody was waiting!
             return;
@@ -75,6 +89,9 @@ struct WordLockBase {
 
 protected:
     friend struct TestWebKitAPI::LockInspector;
+#if ENABLE(LOCK_PROFILING)
+    friend class LockProfiler;
+#endif
     
     static const uintptr_t isLockedBit = 1;
     static const uintptr_t isQueueLockedBit = 2;
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WTF_WorkStealingDeque_h
+#define WTF_WorkStealingDeque_h
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <wtf/FastMalloc.h>
+#include <wtf/MathExtras.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace WTF {
+
+// A Chase-Lev work-stealing deque. One thread, the owner, pushes and pops at the bottom; any number
+// of other threads steal from the top. Only the owner may call push() and pop(). The buffer grows
+// as needed. Buffers that have been grown out of are kept until the deque dies, since a thief may
+// still be reading from one.
+template<typename T>
+class WorkStealingDeque {
+    WTF_MAKE_NONCOPYABLE(WorkStealingDeque);
+    WTF_MAKE_FAST_ALLOCATED;
+    static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque elements are copied racily, so they must be trivially copyable");
+public:
+    explicit WorkStealingDeque(size_t initialCapacity = 64)
+        : m_buffer(new Buffer(roundUpToPowerOfTwo(std::max<uint32_t>(initialCapacity, 1))))
+    {
+    }
+
+    ~WorkStealingDeque()
+    {
+        delete m_buffer.load(std::memory_order_relaxed);
+    }
+
+    void push(T value)
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_acquire);
+        Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+        if (bottom - top >= static_cast<int64_t>(buffer->capacity()))
+            buffer = grow(buffer, top, bottom);
+        buffer->set(bottom, value);
+        // Publishes the element to thieves, who read m_bottom with acquire.
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    bool pop(T& result)
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        result = buffer->get(bottom);
+        if (top < bottom)
+            return true;
+
+        // This was the last element, so race the thieves for it.
+        bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    // May fail spuriously if another thread wins the race for the same element.
+    bool steal(T& result)
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return false;
+
+        Buffer* buffer = m_buffer.load(std::memory_order_acquire);
+        T value = buffer->get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return false;
+        result = value;
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return m_top.load(std::memory_order_acquire) >= m_bottom.load(std::memory_order_acquire);
+    }
+
+private:
+    class Buffer {
+        WTF_MAKE_FAST_ALLOCATED;
+    public:
+        explicit Buffer(size_t capacity)
+            : m_mask(capacity - 1)
+            , m_slots(std::make_unique<std::atomic<T>[]>(capacity))
+        {
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+        T get(int64_t index) const { return m_slots[index & m_mask].load(std::memory_order_relaxed); }
+        void set(int64_t index, T value) { m_slots[index & m_mask].store(value, std::memory_order_relaxed); }
+
+    private:
+        size_t m_mask;
+        std::unique_ptr<std::atomic<T>[]> m_slots;
+    };
+
+    Buffer* grow(Buffer* buffer, int64_t top, int64_t bottom)
+    {
+        Buffer* newBuffer = new Buffer(buffer->capacity() * 2);
+        for (int64_t i = top; i < bottom; ++i)
+            newBuffer->set(i, buffer->get(i));
+        m_retiredBuffers.append(std::unique_ptr<Buffer>(buffer));
+        m_buffer.store(newBuffer, std::memory_order_release);
+        return newBuffer;
+    }
+
+    std::atomic<int64_t> m_top { 0 };
+    std::atomic<int64_t> m_bottom { 0 };
+    std::atomic<Buffer*> m_buffer;
+    Vector<std::unique_ptr<Buffer>> m_retiredBuffers;
+};
+
+} // namespace WTF
+
+using WTF::WorkStealingDeque;
+
+#endif // WTF_WorkStealingDeque_h
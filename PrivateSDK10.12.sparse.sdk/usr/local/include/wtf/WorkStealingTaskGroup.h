@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WTF_WorkStealingTaskGroup_h
+#define WTF_WorkStealingTaskGroup_h
+
+#include <atomic>
+#include <memory>
+#include <wtf/Condition.h>
+#include <wtf/Function.h>
+#include <wtf/Lock.h>
+#include <wtf/ParallelHelperPool.h>
+#include <wtf/Threading.h>
+#include <wtf/Vector.h>
+#include <wtf/WeakRandom.h>
+#include <wtf/WorkStealingDeque.h>
+
+namespace WTF {
+
+// A WorkStealingTaskGroup runs a dynamic tree of small tasks on a ParallelHelperPool. Each thread that
+// takes part has its own WorkStealingDeque; it runs its own tasks newest-first and steals the oldest
+// tasks of a random other thread when it runs dry. The helper threads come from the pool through an
+// ordinary ParallelHelperClient, so any number of groups, the parallel marker and the compiler threads
+// can all share one pool without running more threads than it has.
+//
+// The thread that creates the group owns it. Only the owner may call wait(). spawn() and join() may be
+// called by the owner and from inside any task of the group:
+//
+//    WorkStealingTaskGroup group(pool);
+//    for (auto& block : blocks)
+//        group.spawn([&] { block.sweep(); });
+//    group.wait();
+//
+// Helper threads join once the owner calls wait(), and wait() returns when every task, including the
+// tasks spawned by other tasks, has finished. A thread that finds nothing to run or steal parks until
+// spawn() publishes a task or the task it is waiting for finishes.
+class WorkStealingTaskGroup {
+    WTF_MAKE_NONCOPYABLE(WorkStealingTaskGroup);
+    WTF_MAKE_FAST_ALLOCATED;
+public:
+    explicit WorkStealingTaskGroup(RefPtr<ParallelHelperPool> pool)
+        : m_client(WTFMove(pool))
+    {
+        unsigned workerCount = m_client.pool().numberOfThreads() + 1;
+        m_workers.reserveInitialCapacity(workerCount);
+        for (unsigned i = 0; i < workerCount; ++i)
+            m_workers.uncheckedAppend(std::make_unique<Worker>());
+        m_workers[0]->thread.store(currentThread(), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingTaskGroup()
+    {
+        wait();
+    }
+
+    template<typename Functor>
+    void spawn(Functor functor)
+    {
+        Function<void ()> function(WTFMove(functor));
+        m_pendingTaskCount.fetch_add(1, std::memory_order_relaxed);
+        currentWorker().deque.push(function.leakCallable());
+        notifyIdleWorkers();
+    }
+
+    // Runs first on the calling thread while second is up for stealing, and returns once both are
+    // done. While waiting for second, the calling thread runs other tasks of the group.
+    template<typename First, typename Second>
+    void join(const First& first, const Second& second)
+    {
+        std::atomic<bool> secondIsDone { false };
+        spawn([&] {
+            second();
+            secondIsDone.store(true, std::memory_order_release);
+            notifyIdleWorkers();
+        });
+        first();
+
+        Worker& worker = currentWorker();
+        runUntil(worker, [&] { return secondIsDone.load(std::memory_order_acquire); });
+    }
+
+    void wait()
+    {
+        ASSERT(currentThread() == m_workers[0]->thread.load(std::memory_order_relaxed));
+        if (!m_pendingTaskCount.load(std::memory_order_acquire))
+            return;
+
+        m_nextWorkerIndex.store(1, std::memory_order_relaxed);
+        m_client.setFunction([this] { helperThreadBody(); });
+        runUntilIdle(*m_workers[0]);
+        m_client.finish();
+
+        for (unsigned i = 1; i < m_workers.size(); ++i)
+            m_workers[i]->thread.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    typedef Function<void ()>::CallableWrapperBase Task;
+
+    struct Worker {
+        WTF_MAKE_FAST_ALLOCATED;
+    public:
+        WorkStealingDeque<Task*> deque;
+        std::atomic<ThreadIdentifier> thread { 0 };
+        WeakRandom random;
+    };
+
+    Worker& currentWorker()
+    {
+        ThreadIdentifier thread = currentThread();
+        for (auto& worker : m_workers) {
+            if (worker->thread.load(std::memory_order_relaxed) == thread)
+                return *worker;
+        }
+        RELEASE_ASSERT_NOT_REACHED();
+        return *m_workers[0];
+    }
+
+    void helperThreadBody()
+    {
+        unsigned index = m_nextWorkerIndex.fetch_add(1, std::memory_order_relaxed);
+        // The pool grew after this group was created; the threads we have are enough.
+        if (index >= m_workers.size())
+            return;
+        Worker& worker = *m_workers[index];
+        worker.thread.store(currentThread(), std::memory_order_relaxed);
+        runUntilIdle(worker);
+    }
+
+    void runUntilIdle(Worker& worker)
+    {
+        runUntil(worker, [&] { return !m_pendingTaskCount.load(std::memory_order_acquire); });
+    }
+
+    template<typename Predicate>
+    void runUntil(Worker& worker, const Predicate& isDone)
+    {
+        while (!isDone()) {
+            if (!runOneTask(worker))
+                park(isDone);
+        }
+    }
+
+    bool runOneTask(Worker& worker)
+    {
+        Task* task;
+        if (!worker.deque.pop(task) && !steal(worker, task))
+            return false;
+
+        Function<void ()>::adoptCallable(task)();
+        if (m_pendingTaskCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            notifyIdleWorkers();
+        return true;
+    }
+
+    bool hasStealableTask()
+    {
+        for (auto& worker : m_workers) {
+            if (!worker->deque.isEmpty())
+                return true;
+        }
+        return false;
+    }
+
+    // Sleeps until isDone() or there is a task to steal. Every change to either is followed by
+    // notifyIdleWorkers(), which either sees m_idleWorkerCount raised or happens early enough for the
+    // checks below to see the change.
+    template<typename Predicate>
+    void park(const Predicate& isDone)
+    {
+        LockHolder locker(m_idleLock);
+        m_idleWorkerCount.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!isDone() && !hasStealableTask())
+            m_idleCondition.wait(m_idleLock);
+        m_idleWorkerCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notifyIdleWorkers()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_idleWorkerCount.load(std::memory_order_relaxed))
+            return;
+        // Taking the lock orders us after a parking thread's last check, so it cannot miss the wake-up.
+        LockHolder locker(m_idleLock);
+        m_idleCondition.notifyAll();
+    }
+
+    bool steal(Worker& thief, Task*& task)
+    {
+        unsigned workerCount = m_workers.size();
+        unsigned start = thief.random.getUint32() % workerCount;
+        for (unsigned i = 0; i < workerCount; ++i) {
+            Worker& victim = *m_workers[(start + i) % workerCount];
+            if (&victim != &thief && victim.deque.steal(task))
+                return true;
+        }
+        return false;
+    }
+
+    ParallelHelperClient m_client;
+    Vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<unsigned> m_nextWorkerIndex { 1 };
+    std::atomic<size_t> m_pendingTaskCount { 0 };
+    std::atomic<unsigned> m_idleWorkerCount { 0 };
+    Lock m_idleLock;
+    Condition m_idleCondition;
+};
+
+template<typename Functor>
+void parallelForInRange(WorkStealingTaskGroup& group, size_t begin, size_t end, size_t grainSize, const Functor& functor)
+{
+    // Split off the upper half for stealing until what is left is small enough to run here.
+    while (end - begin > grainSize) {
+        size_t middle = begin + (end - begin) / 2;
+        group.spawn([&group, middle, end, grainSize, &functor] {
+            parallelForInRange(group, middle, end, grainSize, functor);
+        });
+        end = middle;
+    }
+    if (begin < end)
+        functor(begin, end);
+}
+
+// Calls functor(rangeBegin, rangeEnd) for disjoint subranges, of at most grainSize indices, that
+// together cover [begin, end).
+template<typename Functor>
+void parallelFor(RefPtr<ParallelHelperPool> pool, size_t begin, size_t end, size_t grainSize, const Functor& functor)
+{
+    if (begin >= end)
+        return;
+    WorkStealingTaskGroup group(WTFMove(pool));
+    parallelForInRange(group, begin, end, std::max<size_t>(grainSize, 1), functor);
+    group.wait();
+}
+
+template<typename T, typename MapFunctor, typename CombineFunctor>
+T parallelReduceInRange(WorkStealingTaskGroup& group, size_t begin, size_t end, size_t grainSize, const MapFunctor& map, const CombineFunctor& combine)
+{
+    if (end - begin <= grainSize)
+        return map(begin, end);
+
+    size_t middle = begin + (end - begin) / 2;
+    T lower;
+    T upper;
+    group.join(
+        [&] { lower = parallelReduceInRange<T>(group, begin, middle, grainSize, map, combine); },
+        [&] { upper = parallelReduceInRange<T>(group, middle, end, grainSize, map, combine); });
+    return combine(WTFMove(lower), WTFMove(upper));
+}
+
+// Returns the combination of map(rangeBegin, rangeEnd) over subranges of at most grainSize indices
+// that cover [begin, end), or identity if the range is empty. Subranges are combined in index order,
+// so combine only needs to be associative.
+template<typename T, typename MapFunctor, typename CombineFunctor>
+T parallelReduce(RefPtr<ParallelHelperPool> pool, size_t begin, size_t end, size_t grainSize, T identity, const MapFunctor& map, const CombineFunctor& combine)
+{
+    if (begin >= end)
+        return identity;
+    WorkStealingTaskGroup group(WTFMove(pool));
+    T result = identity;
+    group.spawn([&] { result = parallelReduceInRange<T>(group, begin, end, std::max<size_t>(grainSize, 1), map, combine); });
+    group.wait();
+    return result;
+}
+
+} // namespace WTF
+
+using WTF::WorkStealingTaskGroup;
+using WTF::parallelFor;
+using WTF::parallelReduce;
+
+#endif // WTF_WorkStealingTaskGroup_h
@@ -24,6 +24,7 @@
 #include <unicode/utypes.h>
 #include <wtf/ASCIICType.h>
 #include <wtf/dtoa/double-conversion.h>
+#include <wtf/dtoa/eisel-lemire.h>
 #include <wtf/text/StringView.h>
 
 namespace WTF {
@@ -53,6 +54,9 @@ namespace Internal {
 
 inline double parseDouble(const LChar* string, size_t length, size_t& parsedLength)
 {
+    double result;
+    if (EiselLemire::parseDecimal(string, length, parsedLength, result))
+        return result;
     return double_conversion::StringToDoubleConverter::StringToDouble(reinterpret_cast<const char*>(string), length, &parsedLength);
 }
 
@@ -69,12 +69,37 @@ template<> struct NonASCIIMask<8, LChar> {
 };
 
 
+template<size_t size> struct NonLatin1Mask;
+template<> struct NonLatin1Mask<4> {
+    static inline uint32_t value() { return 0xFF00FF00U; }
+};
+template<> struct NonLatin1Mask<8> {
+    static inline uint64_t value() { return 0xFF00FF00FF00FF00ULL; }
+};
+
 template<typename CharacterType>
 inline bool isAllASCII(MachineWord word)
 {
     return !(word & NonASCIIMask<sizeof(MachineWord), CharacterType>::value());
 }
 
+#if OS(DARWIN) && (CPU(X86) || CPU(X86_64))
+namespace Internal {
+const size_t vectorSize = sizeof(__m128i);
+}
+
+template<typename CharacterType> inline bool isAllASCII(__m128i);
+template<> inline bool isAllASCII<LChar>(__m128i vector)
+{
+    return !_mm_movemask_epi8(vector);
+}
+template<> inline bool isAllASCII<UChar>(__m128i vector)
+{
+    __m128i nonASCIIBits = _mm_and_si128(vector, _mm_set1_epi16(static_cast<short>(0xFF80)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(nonASCIIBits, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
 // Note: This function assume the input is likely all ASCII, and
 // does not leave early if it is not the case.
 template<typename CharacterType>
@@ -89,6 +114,19 @@ inline bool charactersAreAllASCII(const CharacterType* characters, size_t length
         ++characters;
     }
 
+#if OS(DARWIN) && (CPU(X86) || CPU(X86_64))
+    // Compare 16 bytes at a time.
+    const size_t vectorIncrement = Internal::vectorSize / sizeof(CharacterType);
+    if (static_cast<size_t>(end - characters) >= vectorIncrement) {
+        __m128i allVectorBits = _mm_setzero_si128();
+        const CharacterType* vectorEnd = end - vectorIncrement;
+        for (; characters <= vectorEnd; characters += vectorIncrement)
+            allVectorBits = _mm_or_si128(allVectorBits, _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters)));
+        if (!isAllASCII<CharacterType>(allVectorBits))
+            return false;
+    }
+#endif
+
     // Compare the values of CPU word size.
     const CharacterType* wordEnd = alignToMachineWord(end);
     const size_t loopIncrement = sizeof(MachineWord) / sizeof(CharacterType);
@@ -107,6 +145,112 @@ inline bool charactersAreAllASCII(const CharacterType* characters, size_t length
     return !(allCharBits & nonASCIIBitMask);
 }
 
+// Tells whether a 16-bit string could be stored as an 8-bit one, as StringImpl::create8BitIfPossible() does.
+// Like charactersAreAllASCII(), this assumes the answer is likely yes and does not leave early.
+inline bool charactersAreAllLatin1(const UChar* characters, size_t length)
+{
+    MachineWord allCharBits = 0;
+    const UChar* end = characters + length;
+
+    // Prologue: align the input.
+    while (!isAlignedToMachineWord(characters) && characters != end) {
+        allCharBits |= *characters;
+        ++characters;
+    }
+
+#if OS(DARWIN) && (CPU(X86) || CPU(X86_64))
+    // Compare 16 bytes at a time.
+    const size_t vectorIncrement = Internal::vectorSize / sizeof(UChar);
+    if (static_cast<size_t>(end - characters) >= vectorIncrement) {
+        __m128i allVectorBits = _mm_setzero_si128();
+        const UChar* vectorEnd = end - vectorIncrement;
+        for (; characters <= vectorEnd; characters += vectorIncrement)
+            allVectorBits = _mm_or_si128(allVectorBits, _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_srli_epi16(allVectorBits, 8), _mm_setzero_si128())) != 0xFFFF)
+            return false;
+    }
+#endif
+
+    // Compare the values of CPU word size.
+    const UChar* wordEnd = alignToMachineWord(end);
+    const size_t loopIncrement = sizeof(MachineWord) / sizeof(UChar);
+    while (characters < wordEnd) {
+        allCharBits |= *(reinterpret_cast_ptr<const MachineWord*>(characters));
+        characters += loopIncrement;
+    }
+
+    // Process the remaining characters.
+    while (characters != end) {
+        allCharBits |= *characters;
+        ++characters;
+    }
+
+    return !(allCharBits & NonLatin1Mask<sizeof(MachineWord)>::value());
+}
+
+// Returns the number of leading characters that are ASCII. Unlike charactersAreAllASCII(), this stops at
+// the first non-ASCII character, which suits converters walking text that is mostly but not only ASCII.
+template<typename CharacterType>
+inline size_t lengthOfASCIIPrefix(const CharacterType* characters, size_t length)
+{
+    size_t i = 0;
+
+#if OS(DARWIN) && (CPU(X86) || CPU(X86_64))
+    const size_t vectorIncrement = Internal::vectorSize / sizeof(CharacterType);
+    for (; i + vectorIncrement <= length; i += vectorIncrement) {
+        if (!isAllASCII<CharacterType>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(characters + i))))
+            break;
+    }
+#endif
+
+    for (; i < length; ++i) {
+        if (characters[i] & ~0x7F)
+            break;
+    }
+    return i;
+}
+
+// Widens the leading ASCII characters of a Latin-1 or UTF-8 source into UTF-16 and returns how many were copied.
+inline size_t copyASCIIPrefix(UChar* destination, const LChar* source, size_t length)
+{
+    size_t i = 0;
+
+#if OS(DARWIN) && (CPU(X86) || CPU(X86_64))
+    for (; i + Internal::vectorSize <= length; i += Internal::vectorSize) {
+        __m128i characters = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        if (!isAllASCII<LChar>(characters))
+            break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi8(characters, _mm_setzero_si128()));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + Internal::vectorSize / 2), _mm_unpackhi_epi8(characters, _mm_setzero_si128()));
+    }
+#endif
+
+    for (; i < length && !(source[i] & 0x80); ++i)
+        destination[i] = source[i];
+    return i;
+}
+
+// Narrows the leading ASCII characters of a UTF-16 source into UTF-8 and returns how many were copied.
+inline size_t copyASCIIPrefix(LChar* destination, const UChar* source, size_t length)
+{
+    size_t i = 0;
+
+#if OS(DARWIN) && (CPU(X86) || CPU(X86_64))
+    const size_t vectorIncrement = 2 * Internal::vectorSize / sizeof(UChar);
+    for (; i + vectorIncrement <= length; i += vectorIncrement) {
+        __m128i first8UChars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m128i second8UChars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + vectorIncrement / 2));
+        if (!isAllASCII<UChar>(_mm_or_si128(first8UChars, second8UChars)))
+            break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(first8UChars, second8UChars));
+    }
+#endif
+
+    for (; i < length && !(source[i] & ~0x7F); ++i)
+        destination[i] = static_cast<LChar>(source[i]);
+    return i;
+}
+
 inline void copyLCharsFromUCharSource(LChar* destination, const UChar* source, size_t length)
 {
 #if OS(DARWIN) && (CPU(X86) || CPU(X86_64))
@@ -32,6 +32,10 @@
 #include <wtf/text/CString.h>
 #include <wtf/text/WTFString.h>
 
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
 namespace WTF {
 
 enum Base64EncodePolicy {
@@ -46,6 +50,11 @@ enum Base64DecodeOptions {
     Base64IgnoreSpacesAndNewLines = 1 << 1,
 };
 
+enum Base64Alphabet {
+    Base64StandardAlphabet, // '+' and '/'.
+    Base64URLAlphabet // '-' and '_', as defined in RFC 4648.
+};
+
 class SignedOrUnsignedCharVectorAdapter {
 public:
     SignedOrUnsignedCharVectorAdapter(Vector<char>& vector) { m_vector.c = &vector; }
@@ -145,6 +154,353 @@ inline String base64URLEncode(const CString& in)
     return base64URLEncode(in.data(), in.length());
 }
 
+// ======================================================================================
+// Incremental encoding and decoding.
+// These produce the same output as the functions above, but work on chunks of input and
+// write into caller-provided buffers, so large payloads never need to be held twice.
+// ======================================================================================
+
+class Base64Encoder {
+public:
+    explicit Base64Encoder(Base64EncodePolicy policy = Base64DoNotInsertLFs, Base64Alphabet alphabet = Base64StandardAlphabet)
+        : m_policy(policy)
+        , m_alphabet(alphabet)
+    {
+    }
+
+    // The most characters encode() can write for an input of the given length.
+    static size_t maximumEncodedLength(size_t length)
+    {
+        size_t quads = (length + 2) / 3;
+        return quads * 4 + quads / lineLengthInQuads + 1;
+    }
+
+    // The most characters finish() can write.
+    static const size_t maximumFinishLength = 5;
+
+    // Encodes all complete 3-byte groups and keeps up to 2 trailing bytes for the next call.
+    // Returns the number of characters written to destination.
+    size_t encode(const void* data, size_t length, char* destination)
+    {
+        const uint8_t* source = static_cast<const uint8_t*>(data);
+        const uint8_t* end = source + length;
+        char* out = destination;
+
+        if (m_pendingLength) {
+            while (m_pendingLength < 3 && source < end)
+                m_pending[m_pendingLength++] = *source++;
+            if (m_pendingLength < 3)
+                return 0;
+            out = encodeQuad(m_pending, out);
+            m_pendingLength = 0;
+        }
+
+        while (end - source >= 3) {
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSSE3__)
+            // The vector kernel reads 16 bytes and consumes 12 of them.
+            if (end - source >= 16 && !lineBreakWithinNextQuads(4)) {
+                out = appendLineBreakIfNeeded(out);
+                encodeVector(source, out);
+                source += 12;
+                out += 16;
+                m_quadCount += 4;
+                continue;
+            }
+#endif
+            out = encodeQuad(source, out);
+            source += 3;
+        }
+
+        while (source < end)
+            m_pending[m_pendingLength++] = *source++;
+
+        return out - destination;
+    }
+
+    // Encodes the trailing bytes, with padding unless the policy is Base64URLPolicy, and resets
+    // the encoder. Returns the number of characters written to destination.
+    size_t finish(char* destination)
+    {
+        char* out = destination;
+        if (m_pendingLength) {
+            out = appendLineBreakIfNeeded(out);
+            uint8_t first = m_pending[0];
+            uint8_t second = m_pendingLength > 1 ? m_pending[1] : 0;
+            *out++ = encodeSextet(first >> 2);
+            *out++ = encodeSextet(((first << 4) | (second >> 4)) & 0x3F);
+            if (m_pendingLength > 1)
+                *out++ = encodeSextet((second << 2) & 0x3F);
+            else if (m_policy != Base64URLPolicy)
+                *out++ = '=';
+            if (m_policy != Base64URLPolicy)
+                *out++ = '=';
+        }
+        m_pendingLength = 0;
+        m_quadCount = 0;
+        return out - destination;
+    }
+
+private:
+    // RFC 2045 limits lines to 76 characters.
+    static const size_t lineLengthInQuads = 19;
+
+    char encodeSextet(unsigned sextet) const
+    {
+        ASSERT(sextet < 64);
+        if (m_alphabet == Base64URLAlphabet)
+            return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"[sextet];
+        return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[sextet];
+    }
+
+    char* appendLineBreakIfNeeded(char* out) const
+    {
+        if (m_policy == Base64InsertLFs && m_quadCount && !(m_quadCount % lineLengthInQuads))
+            *out++ = '\n';
+        return out;
+    }
+
+    // Whether a line break is due before any quad after the next one, within the next count quads.
+    bool lineBreakWithinNextQuads(size_t count) const
+    {
+        return m_policy == Base64InsertLFs && m_quadCount % lineLengthInQuads + count > lineLengthInQuads;
+    }
+
+    char* encodeQuad(const uint8_t* source, char* out)
+    {
+        out = appendLineBreakIfNeeded(out);
+        *out++ = encodeSextet(source[0] >> 2);
+        *out++ = encodeSextet(((source[0] << 4) | (source[1] >> 4)) & 0x3F);
+        *out++ = encodeSextet(((source[1] << 2) | (source[2] >> 6)) & 0x3F);
+        *out++ = encodeSextet(source[2] & 0x3F);
+        ++m_quadCount;
+        return out;
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSSE3__)
+    // Encodes the first 12 of the 16 bytes at source into 16 characters.
+    void encodeVector(const uint8_t* source, char* out) const
+    {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+
+        // Lay out each 3-byte group as [b1, b0, b2, b1] and pull the four sextets into separate bytes.
+        input = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        __m128i high = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        __m128i low = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        __m128i sextets = _mm_or_si128(high, low);
+
+        // Map each sextet to a range: 0 for 'a'-'z', 1-10 for '0'-'9', 11 and 12 for the last two
+        // characters and 13 for 'A'-'Z'. The range then selects the offset to add to the sextet.
+        __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), sextets), _mm_set1_epi8(13)));
+        char offset62 = (m_alphabet == Base64URLAlphabet ? '-' : '+') - 62;
+        char offset63 = (m_alphabet == Base64URLAlphabet ? '_' : '/') - 63;
+        __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, offset62, offset63, 'A', 0, 0);
+        __m128i result = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), sextets);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), result);
+    }
+#endif
+
+    Base64EncodePolicy m_policy;
+    Base64Alphabet m_alphabet;
+    size_t m_quadCount { 0 };
+    uint8_t m_pending[3];
+    unsigned m_pendingLength { 0 };
+};
+
+class Base64Decoder {
+public:
+    explicit Base64Decoder(unsigned options = Base64Default, Base64Alphabet alphabet = Base64StandardAlphabet)
+        : m_options(options)
+        , m_alphabet(alphabet)
+    {
+    }
+
+    // The most bytes decode() can write for an input of the given length.
+    static size_t maximumDecodedLength(size_t length) { return (length + 3) / 4 * 3; }
+
+    // The most bytes finish() can write.
+    static const size_t maximumFinishLength = 2;
+
+    // Decodes all complete 4-character groups and keeps up to 3 trailing characters for the next call.
+    // On return, decodedLength holds the number of bytes written to destination. Returns false, and
+    // keeps failing until finish(), once the input is known to be invalid.
+    bool decode(const char* data, size_t length, uint8_t* destination, size_t& decodedLength)
+    {
+        return decode(reinterpret_cast<const LChar*>(data), length, destination, decodedLength);
+    }
+
+    bool decode(const LChar* data, size_t length, uint8_t* destination, size_t& decodedLength)
+    {
+        size_t index = 0;
+        uint8_t* out = destination;
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSSE3__)
+        while (!m_hadError && !m_pendingLength && !m_equalsSignCount && length - index >= 16) {
+            if (decodeVector(data + index, out)) {
+                out += 12;
+                m_hasDecodedCharacters = true;
+            } else {
+                // Padding, whitespace or an invalid character; let the scalar path sort it out.
+                for (size_t end = index + 16; index < end; ++index)
+                    out = decodeCharacter(data[index], out);
+                continue;
+            }
+            index += 16;
+        }
+#endif
+        for (; index < length && !m_hadError; ++index)
+            out = decodeCharacter(data[index], out);
+        decodedLength = out - destination;
+        return !m_hadError;
+    }
+
+    bool decode(const UChar* data, size_t length, uint8_t* destination, size_t& decodedLength)
+    {
+        uint8_t* out = destination;
+        for (size_t index = 0; index < length && !m_hadError; ++index)
+            out = decodeCharacter(data[index], out);
+        decodedLength = out - destination;
+        return !m_hadError;
+    }
+
+    // Validates the end of the input, decodes the trailing characters and resets the decoder.
+    // Returns false if the input as a whole was not valid base64.
+    bool finish(uint8_t* destination, size_t& decodedLength)
+    {
+        decodedLength = 0;
+        bool result = finishInternal(destination, decodedLength);
+        m_pendingLength = 0;
+        m_equalsSignCount = 0;
+        m_hasDecodedCharacters = false;
+        m_hadError = false;
+        return result;
+    }
+
+private:
+    int decodeSextet(UChar character) const
+    {
+        if (character >= 'A' && character <= 'Z')
+            return character - 'A';
+        if (character >= 'a' && character <= 'z')
+            return character - 'a' + 26;
+        if (character >= '0' && character <= '9')
+            return character - '0' + 52;
+        if (character == (m_alphabet == Base64URLAlphabet ? '-' : '+'))
+            return 62;
+        if (character == (m_alphabet == Base64URLAlphabet ? '_' : '/'))
+            return 63;
+        return -1;
+    }
+
+    uint8_t* decodeCharacter(UChar character, uint8_t* out)
+    {
+        if (character == '=') {
+            ++m_equalsSignCount;
+            // There should never be more than 2 padding characters.
+            if (m_options & Base64ValidatePadding && m_equalsSignCount > 2)
+                m_hadError = true;
+            return out;
+        }
+
+        int sextet = decodeSextet(character);
+        if (sextet < 0) {
+            if (!(m_options & Base64IgnoreSpacesAndNewLines) || !isSpaceOrNewline(character))
+                m_hadError = true;
+            return out;
+        }
+
+        // Padding is only allowed at the end.
+        if (m_equalsSignCount) {
+            m_hadError = true;
+            return out;
+        }
+
+        m_hasDecodedCharacters = true;
+        m_pending[m_pendingLength++] = sextet;
+        if (m_pendingLength < 4)
+            return out;
+
+        *out++ = (m_pending[0] << 2) | (m_pending[1] >> 4);
+        *out++ = (m_pending[1] << 4) | (m_pending[2] >> 2);
+        *out++ = (m_pending[2] << 6) | m_pending[3];
+        m_pendingLength = 0;
+        return out;
+    }
+
+    bool finishInternal(uint8_t* out, size_t& decodedLength)
+    {
+        if (m_hadError)
+            return false;
+
+        if (!m_hasDecodedCharacters)
+            return !m_equalsSignCount;
+
+        // There should be no padding if the length is a multiple of 4. Ignored characters do not count.
+        if (m_options & Base64ValidatePadding && m_equalsSignCount && (m_pendingLength + m_equalsSignCount) % 4)
+            return false;
+
+        // Valid data is (n * 4 + [0,2,3]) characters long.
+        if (m_pendingLength == 1)
+            return false;
+
+        if (m_pendingLength >= 2)
+            out[decodedLength++] = (m_pending[0] << 2) | (m_pending[1] >> 4);
+        if (m_pendingLength == 3)
+            out[decodedLength++] = (m_pending[1] << 4) | (m_pending[2] >> 2);
+        return true;
+    }
+
+#if (CPU(X86) || CPU(X86_64)) && defined(__SSSE3__)
+    // Decodes 16 characters into 12 bytes. Returns false, without writing anything, if any of the
+    // characters is not in the alphabet.
+    bool decodeVector(const LChar* source, uint8_t* out) const
+    {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+
+        // Bytes >= 0x80 compare as negative and so fall outside every range.
+        auto inRange = [&] (char low, char high) {
+            return _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(input, _mm_set1_epi8(high + 1)));
+        };
+        char character62 = m_alphabet == Base64URLAlphabet ? '-' : '+';
+        char character63 = m_alphabet == Base64URLAlphabet ? '_' : '/';
+        __m128i isUpper = inRange('A', 'Z');
+        __m128i isLower = inRange('a', 'z');
+        __m128i isDigit = inRange('0', '9');
+        __m128i is62 = _mm_cmpeq_epi8(input, _mm_set1_epi8(character62));
+        __m128i is63 = _mm_cmpeq_epi8(input, _mm_set1_epi8(character63));
+
+        __m128i valid = _mm_or_si128(_mm_or_si128(isUpper, isLower), _mm_or_si128(isDigit, _mm_or_si128(is62, is63)));
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            return false;
+
+        __m128i offsets = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(isUpper, _mm_set1_epi8(-'A')), _mm_and_si128(isLower, _mm_set1_epi8(26 - 'a'))),
+            _mm_or_si128(_mm_and_si128(isDigit, _mm_set1_epi8(52 - '0')),
+                _mm_or_si128(_mm_and_si128(is62, _mm_set1_epi8(62 - character62)), _mm_and_si128(is63, _mm_set1_epi8(63 - character63)))));
+        __m128i sextets = _mm_add_epi8(input, offsets);
+
+        // Merge each group of four sextets into a 24-bit value, then gather the three bytes of each.
+        __m128i merged = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        __m128i packed = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+        uint32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        memcpy(out + 8, &tail, sizeof(tail));
+        return true;
+    }
+#endif
+
+    unsigned m_options;
+    Base64Alphabet m_alphabet;
+    uint8_t m_pending[4];
+    unsigned m_pendingLength { 0 };
+    unsigned m_equalsSignCount { 0 };
+    bool m_hasDecodedCharacters { false };
+    bool m_hadError { false };
+};
+
 } // namespace WTF
 
 using WTF::Base64EncodePolicy;
@@ -155,5 +511,7 @@ using WTF::Base64IgnoreSpacesAndNewLines;
 using WTF::base64Encode;
 using WTF::base64Decode;
 using WTF::base64URLDecode;
+using WTF::Base64Encoder;
+using WTF::Base64Decoder;
 
 #endif // Base64_h
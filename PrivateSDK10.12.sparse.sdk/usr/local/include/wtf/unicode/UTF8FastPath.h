@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2016 Apple Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WTF_UTF8FastPath_h
+#define WTF_UTF8FastPath_h
+
+#include <algorithm>
+#include <string.h>
+#include <unicode/utf16.h>
+#include <wtf/text/ASCIIFastPath.h>
+#include <wtf/unicode/CharacterNames.h>
+#include <wtf/unicode/UTF8.h>
+
+namespace WTF {
+namespace Unicode {
+
+// Inline counterparts of the converters in UTF8.h for text that is mostly ASCII. ASCII runs are
+// copied a vector at a time by the ASCIIFastPath.h helpers; every other character goes through the
+// same validation as UTF8.cpp, so the results, including where sourceStart and targetStart are left
+// on failure, match the out-of-line versions. The one difference is that every trailing UTF-8 byte
+// must be a continuation byte; isLegalUTF8() skips that check for the byte after 0xED and 0xF4.
+
+namespace Internal {
+
+// Same as inlineUTF8SequenceLength() in UTF8.cpp: 1 for bytes that cannot start a multi-byte
+// sequence, so that isLegalUTF8Sequence() rejects stray continuation bytes.
+inline int utf8SequenceLength(LChar leadByte)
+{
+    if ((leadByte & 0xC0) != 0xC0)
+        return 1;
+    if ((leadByte & 0xE0) == 0xC0)
+        return 2;
+    if ((leadByte & 0xF0) == 0xE0)
+        return 3;
+    if ((leadByte & 0xF8) == 0xF0)
+        return 4;
+    return 0;
+}
+
+// Rejects overlong forms, encoded surrogates and values past U+10FFFF, like isLegalUTF8() in UTF8.cpp.
+// The caller has already checked that length bytes are available.
+inline bool isLegalUTF8Sequence(const LChar* sequence, int length)
+{
+    LChar leadByte = sequence[0];
+    if (length < 2 || leadByte < 0xC2 || leadByte > 0xF4)
+        return false;
+    for (int i = 1; i < length; ++i) {
+        if ((sequence[i] & 0xC0) != 0x80)
+            return false;
+    }
+    switch (leadByte) {
+    case 0xE0:
+        return sequence[1] >= 0xA0;
+    case 0xED:
+        return sequence[1] <= 0x9F;
+    case 0xF0:
+        return sequence[1] >= 0x90;
+    case 0xF4:
+        return sequence[1] <= 0x8F;
+    default:
+        return true;
+    }
+}
+
+inline UChar32 decodeLegalUTF8Sequence(const LChar* sequence, int length)
+{
+    switch (length) {
+    case 2:
+        return ((sequence[0] & 0x1F) << 6) | (sequence[1] & 0x3F);
+    case 3:
+        return ((sequence[0] & 0x0F) << 12) | ((sequence[1] & 0x3F) << 6) | (sequence[2] & 0x3F);
+    default:
+        ASSERT(length == 4);
+        return ((sequence[0] & 0x07) << 18) | ((sequence[1] & 0x3F) << 12) | ((sequence[2] & 0x3F) << 6) | (sequence[3] & 0x3F);
+    }
+}
+
+} // namespace Internal
+
+// Unlike convertUTF8ToUTF16(), this has no lenient mode: the legality check already rejects encoded
+// surrogates and values past U+10FFFF, which are all that strict mode adds.
+inline ConversionResult convertUTF8ToUTF16WithASCIIFastPath(const char** sourceStart, const char* sourceEnd, UChar** targetStart, UChar* targetEnd, bool* isSourceAllASCII = nullptr)
+{
+    ConversionResult result = conversionOK;
+    const LChar* source = reinterpret_cast<const LChar*>(*sourceStart);
+    const LChar* end = reinterpret_cast<const LChar*>(sourceEnd);
+    UChar* target = *targetStart;
+    bool sawNonASCII = false;
+    while (source < end) {
+        if (!(*source & 0x80)) {
+            size_t length = copyASCIIPrefix(target, source, std::min<size_t>(end - source, targetEnd - target));
+            if (!length) {
+                result = targetExhausted;
+                break;
+            }
+            source += length;
+            target += length;
+            continue;
+        }
+
+        int sequenceLength = Internal::utf8SequenceLength(*source);
+        if (end - source < sequenceLength) {
+            result = sourceExhausted;
+            break;
+        }
+        if (!Internal::isLegalUTF8Sequence(source, sequenceLength)) {
+            result = sourceIllegal;
+            break;
+        }
+
+        UChar32 character = Internal::decodeLegalUTF8Sequence(source, sequenceLength);
+        if (U_IS_BMP(character)) {
+            if (target >= targetEnd) {
+                result = targetExhausted;
+                break;
+            }
+            *target++ = character;
+        } else {
+            if (targetEnd - target < 2) {
+                result = targetExhausted;
+                break;
+            }
+            *target++ = U16_LEAD(character);
+            *target++ = U16_TRAIL(character);
+        }
+        source += sequenceLength;
+        sawNonASCII = true;
+    }
+    *sourceStart = reinterpret_cast<const char*>(source);
+    *targetStart = target;
+
+    if (isSourceAllASCII)
+        *isSourceAllASCII = !sawNonASCII;
+
+    return result;
+}
+
+inline ConversionResult convertUTF16ToUTF8WithASCIIFastPath(const UChar** sourceStart, const UChar* sourceEnd, char** targetStart, char* targetEnd, bool strict = true)
+{
+    ConversionResult result = conversionOK;
+    const UChar* source = *sourceStart;
+    char* target = *targetStart;
+    while (source < sourceEnd) {
+        if (!(*source & ~0x7F)) {
+            size_t length = copyASCIIPrefix(reinterpret_cast<LChar*>(target), source, std::min<size_t>(sourceEnd - source, targetEnd - target));
+            if (!length) {
+                result = targetExhausted;
+                break;
+            }
+            source += length;
+            target += length;
+            continue;
+        }
+
+        UChar32 character = *source;
+        size_t sourceLength = 1;
+        if (U16_IS_LEAD(character)) {
+            if (sourceEnd - source < 2) {
+                result = sourceExhausted;
+                break;
+            }
+            if (U16_IS_TRAIL(source[1])) {
+                character = U16_GET_SUPPLEMENTARY(character, source[1]);
+                sourceLength = 2;
+            } else if (strict) {
+                result = sourceIllegal;
+                break;
+            }
+        } else if (strict && U16_IS_TRAIL(character)) {
+            result = sourceIllegal;
+            break;
+        }
+
+        // In lenient mode, unpaired surrogates are written out as 3-byte sequences, as convertUTF16ToUTF8() does.
+        int targetLength = character < 0x800 ? 2 : character < 0x10000 ? 3 : 4;
+        if (targetEnd - target < targetLength) {
+            result = targetExhausted;
+            break;
+        }
+        switch (targetLength) {
+        case 2:
+            *target++ = static_cast<char>(0xC0 | (character >> 6));
+            break;
+        case 3:
+            *target++ = static_cast<char>(0xE0 | (character >> 12));
+            *target++ = static_cast<char>(0x80 | ((character >> 6) & 0x3F));
+            break;
+        default:
+            *target++ = static_cast<char>(0xF0 | (character >> 18));
+            *target++ = static_cast<char>(0x80 | ((character >> 12) & 0x3F));
+            *target++ = static_cast<char>(0x80 | ((character >> 6) & 0x3F));
+            break;
+        }
+        *target++ = static_cast<char>(0x80 | (character & 0x3F));
+        source += sourceLength;
+    }
+    *sourceStart = source;
+    *targetStart = target;
+    return result;
+}
+
+inline ConversionResult convertLatin1ToUTF8WithASCIIFastPath(const LChar** sourceStart, const LChar* sourceEnd, char** targetStart, char* targetEnd)
+{
+    ConversionResult result = conversionOK;
+    const LChar* source = *sourceStart;
+    char* target = *targetStart;
+    while (source < sourceEnd) {
+        if (!(*source & 0x80)) {
+            size_t length = lengthOfASCIIPrefix(source, std::min<size_t>(sourceEnd - source, targetEnd - target));
+            if (!length) {
+                result = targetExhausted;
+                break;
+            }
+            memcpy(target, source, length);
+            source += length;
+            target += length;
+            continue;
+        }
+
+        if (targetEnd - target < 2) {
+            result = targetExhausted;
+            break;
+        }
+        *target++ = static_cast<char>(0xC0 | (*source >> 6));
+        *target++ = static_cast<char>(0x80 | (*source & 0x3F));
+        ++source;
+    }
+    *sourceStart = source;
+    *targetStart = target;
+    return result;
+}
+
+} // namespace Unicode
+} // namespace WTF
+
+#endif // WTF_UTF8FastPath_h